@@ -179,6 +179,109 @@ class JSONWriter:
         self.__inhibit_next_indent = True
 
 
+class StreamingResultsWriter:
+    '''
+    Writes results in the streaming, line-delimited format
+
+    The first line of the file is a JSON object holding the metadata of the
+    run (``results_format``, ``name``, ``options``, ``glxinfo``, ...).  Each
+    test result is then appended as one line of the form::
+
+        ["spec/glsl-1.30/linker/do-stuff", {"result": "pass", ...}]
+
+    and a completed run ends with a ``{"time_elapsed": ...}`` line.
+
+    Every line is written with a single ``write`` to a file opened for
+    appending, so the file is valid up to its last complete line at all
+    times and several writers may append to it at once.  Lines are flushed
+    as they are written, and the file is fsync()ed every ``SYNC_INTERVAL``
+    results so that a hang that takes the machine down loses at most a few
+    results.
+
+    The interface matches the subset of ``JSONWriter`` used by
+    ``TestProfile.run``.  StreamingResultsWriter is threadsafe.
+    '''
+
+    FORMAT = 'streaming'
+    SYNC_INTERVAL = 32
+
+    def __init__(self, filename, header=None):
+        '''
+        Open ``filename`` for appending.
+
+        If ``header`` is given, the file is truncated and a new run is
+        started with ``header`` as its metadata.  Otherwise results are
+        appended to an existing run; see ``StreamingResultsWriter.resume``.
+        '''
+        if header is not None:
+            header = dict(header)
+            header['results_format'] = self.FORMAT
+            with open(filename, 'w') as f:
+                f.write(json.dumps(header) + '\n')
+        self.file = open(filename, 'a')
+        self.__unsynced = 0
+
+    @synchronized_self
+    def __write_line(self, obj):
+        self.file.write(json.dumps(obj) + '\n')
+        self.file.flush()
+        self.__unsynced += 1
+        if self.__unsynced >= self.SYNC_INTERVAL:
+            os.fsync(self.file.fileno())
+            self.__unsynced = 0
+
+    def write_dict_item(self, key, value):
+        self.__write_line([key, value])
+
+    @synchronized_self
+    def close(self, time_elapsed):
+        self.__write_line({'time_elapsed': time_elapsed})
+        os.fsync(self.file.fileno())
+        self.file.close()
+
+    @staticmethod
+    def is_streaming(file):
+        '''
+        Return true if ``file`` holds results in the streaming format.
+        The file position is reset to the start of the file.
+        '''
+        file.seek(0)
+        line = file.readline()
+        file.seek(0)
+        try:
+            header = json.loads(line)
+        except ValueError:
+            return False
+        return isinstance(header, dict) and \
+            header.get('results_format') == StreamingResultsWriter.FORMAT
+
+    @staticmethod
+    def resume(filename):
+        '''
+        Prepare an interrupted run for appending.
+
+        Only the test name at the start of each result line is decoded, so
+        this is cheap even for very large files.  An incomplete trailing
+        line, left by a crash in the middle of a write, is cut off.
+
+        :return: ``(header, completed)``, where ``completed`` is the set of
+                 test paths that already have a result.
+        '''
+        completed = set()
+        good_size = 0
+        with open(filename, 'r+') as f:
+            header = json.loads(f.readline())
+            good_size = f.tell()
+            for line in iter(f.readline, ''):
+                if not line.endswith('\n'):
+                    break
+                if line.startswith('["'):
+                    completed.add(json.decoder.scanstring(line, 2)[0])
+                good_size += len(line)
+            f.truncate(good_size)
+        return header, completed
+
+
 # Ensure the given directory exists
 def checkDir(dirname, failifexists):
     exists = True
@@ -259,6 +362,76 @@ class GroupResult(dict):
         return root
 
 
+def pool_error_result(error, crashed):
+    '''
+    Return the TestResult of a test that the concurrent test pool lost:
+    a crash if the worker running it died, otherwise a fail with the
+    traceback of the exception it raised.
+    '''
+    result = TestResult()
+    if crashed:
+        result['result'] = 'crash'
+        result['note'] = error
+    else:
+        result['result'] = 'fail'
+        result['traceback'] = error
+    return result
+
+
+# Statuses from best to worst, for merging results.
+_STATUS_ORDER = ['skip', 'pass', 'warn', 'fail', 'crash']
+
+
+def merge_shard_results(results):
+    '''
+    Merge the TestResults of the shards of a test, each of which ran part
+    of its subtests, into the result the unsplit test would have had.
+
+    The status is the worst of the shards, the time the total of their
+    times, and the subtests, output and resource usage are combined.
+    '''
+    def rank(status):
+        if status in _STATUS_ORDER:
+            return _STATUS_ORDER.index(status)
+        return _STATUS_ORDER.index('fail')
+
+    merged = TestResult(results[0])
+    merged['result'] = max((r['result'] for r in results), key=rank)
+    merged['time'] = sum(r.get('time', 0) for r in results)
+    merged['shards'] = len(results)
+
+    subtests = {}
+    for r in results:
+        subtests.update(r.get('subtest', {}))
+    if subtests:
+        merged['subtest'] = subtests
+
+    for key in ('info', 'command'):
+        if key in merged:
+            merged[key] = '\n'.join(r.get(key, '') for r in results)
+    errors = sum((r.get('errors', []) for r in results), [])
+    if errors:
+        merged['errors'] = errors
+
+    returncodes = [r.get('returncode') for r in results
+                   if r.get('returncode')]
+    if returncodes:
+        merged['returncode'] = returncodes[0]
+
+    if all('rusage' in r for r in results):
+        rusage = dict(results[0]['rusage'])
+        for r in results[1:]:
+            for key, value in r['rusage'].iteritems():
+                if key == 'maxrss':
+                    rusage[key] = max(rusage[key], value)
+                else:
+                    rusage[key] += value
+        merged['rusage'] = rusage
+    else:
+        merged.pop('rusage', None)
+    return merged
+
+
 class TestrunResult:
     def __init__(self):
         self.serialized_keys = ['options',
@@ -342,13 +515,37 @@ class TestrunResult:
         raw_dict = dict([(k, self.__dict__[k]) for k in keys])
         json.dump(raw_dict, file, indent=JSONWriter.INDENT)
 
+    def __parseStreamingFile(self, file):
+        '''
+        Read a file written by ``StreamingResultsWriter`` into the same
+        layout as a JSON results file.
+
+        An incomplete trailing line is ignored.
+        '''
+        raw_dict = json.loads(file.readline())
+        del raw_dict['results_format']
+        raw_dict['tests'] = {}
+        for line in file:
+            try:
+                item = json.loads(line)
+            except ValueError:
+                break
+            if isinstance(item, list):
+                raw_dict['tests'][item[0]] = item[1]
+            else:
+                raw_dict.update(item)
+        return raw_dict
+
     def parseFile(self, file):
         # Attempt to open the json file normally, if it fails then attempt to
         # repair it.
-        try:
-            raw_dict = json.load(file)
-        except ValueError:
-            raw_dict = json.load(self.__repairFile(file))
+        if StreamingResultsWriter.is_streaming(file):
+            raw_dict = self.__parseStreamingFile(file)
+        else:
+            try:
+                raw_dict = json.load(file)
+            except ValueError:
+                raw_dict = json.load(self.__repairFile(file))
 
         # Check that only expected keys were unserialized.
         for key in raw_dict:
@@ -364,8 +561,12 @@ class TestrunResult:
 
 class Environment:
     def __init__(self, concurrent=True, execute=True, include_filter=[],
-                 exclude_filter=[], valgrind=False):
+                 exclude_filter=[], valgrind=False, jobs=None, timings=None):
         self.concurrent = concurrent
+        self.jobs = jobs
+        # Map from test path to the time, in seconds, it took in an
+        # earlier run.  Used to start the longest tests first.
+        self.timings = timings or {}
         self.execute = execute
         self.filter = []
         self.exclude_filter = []
@@ -412,8 +613,9 @@ class Test:
     def __init__(self, runConcurrent=False):
         '''
                 'runConcurrent' controls whether this test will
-                execute it's work (i.e. __doRunWork) on the calling thread
-                (i.e. the main thread) or from the ConcurrentTestPool threads.
+                execute it's work (i.e. execute) on the calling thread
+                (i.e. the main thread) or in the ConcurrentTestPool worker
+                processes.
         '''
         self.runConcurrent = runConcurrent
         self.skip_test = False
@@ -423,60 +625,143 @@ class Test:
 
     def schedule(self, env, path, json_writer):
         '''
-        Schedule test to be run via the concurrent thread pool.
+        Schedule test to be run via the concurrent test pool.
         This is a no-op if the test isn't marked as concurrent.
+        A test that ``shards()`` splits is queued as one item per shard.
 
         See ``Test.doRun`` for a description of the parameters.
         '''
-        args = (env, path, json_writer)
-        if self.runConcurrent:
-            ConcurrentTestPool().put(self.doRun, args=args)
+        def write(items):
+            for (key, result) in items:
+                json_writer.write_dict_item(key, result)
+
+        if not self.runConcurrent:
+            return
+
+        def failed(error, crashed):
+            write([(path, pool_error_result(error, crashed))])
+
+        shards = self.shards() if env.execute else None
+        if not shards:
+            ConcurrentTestPool().put(self.execute, args=(env, path),
+                                     callback=write, error_callback=failed)
+            return
+
+        # Every callback runs on the pool's collector thread, so the
+        # shard results can be gathered without a lock.
+        done = []
+
+        def merge(shard, result):
+            # A shard that crashed never reported the rest of its
+            # subtests.  One the pool lost counts as crashed, so the
+            # merged result is always written and shows what's missing.
+            names = getattr(shard, 'subtests', None)
+            if result['result'] == 'crash' and names:
+                subtests = result.setdefault('subtest', {})
+                for name in names:
+                    subtests.setdefault(name, 'crash')
+            done.append(result)
+            if len(done) == len(shards):
+                write(self.result_items(path, merge_shard_results(done)))
+
+        for shard in shards:
+            ConcurrentTestPool().put(
+                shard.run_result, args=(env, path),
+                callback=lambda result, shard=shard: merge(shard, result),
+                error_callback=lambda error, crashed, shard=shard:
+                    merge(shard, pool_error_result(error, True)))
+
+    def prepare(self, env):
+        '''
+        Do the setup the test shares with others, such as probing the
+        context it runs in.  Called from the main thread for every test
+        before the concurrent test pool forks its workers, so the workers
+        inherit the results instead of each repeating the work.
+        '''
+        pass
+
+    def shards(self):
+        '''
+        Return a list of tests that each run part of the subtests of this
+        one, to be run concurrently and their results merged, or None if
+        the test isn't split.  The ``subtests`` of each shard name the
+        subtests it runs, which are reported as crashed if it crashes
+        before reporting them.
+        '''
+        return None
 
     def doRun(self, env, path, json_writer):
         '''
-        Run the test immediately.
+        Run the test immediately and write its results.
 
         :path:
             Fully qualified test name as a string.  For example,
             ``spec/glsl-1.30/preprocessor/compiler/keywords/void.frag``.
         '''
+        for (key, result) in self.execute(env, path):
+            json_writer.write_dict_item(key, result)
+
+    def execute(self, env, path):
+        '''
+        Run the test immediately.
+
+        Return a list of ``(path, TestResult)`` pairs to be written to the
+        results file: one per subtest if the test has several, otherwise
+        just the test's own result.  The list is empty for a dry run.
+
+        See ``Test.doRun`` for a description of the parameters.
+        '''
+        if env.execute:
+            return self.result_items(path, self.run_result(env, path))
+        else:
+            log(msg="dry-run", channel=path)
+            return []
+
+    def run_result(self, env, path):
+        '''
+        Run the test, and return its TestResult.
+        '''
         def status(msg):
             log(msg=msg, channel=path)
 
-        # Run the test
-        if env.execute:
-            try:
-                status("running")
-                time_start = time.time()
-                result = self.run(env.valgrind)
-                time_end = time.time()
-                if 'time' not in result:
-                    result['time'] = time_end - time_start
-                if 'result' not in result:
-                    result['result'] = 'fail'
-                if not isinstance(result, TestResult):
-                    result = TestResult(result)
-                    result['result'] = 'warn'
-                    result['note'] = 'Result not returned as an instance ' \
-                                     'of TestResult'
-            except:
-                result = TestResult()
+        try:
+            status("running")
+            time_start = time.time()
+            result = self.run(env.valgrind)
+            time_end = time.time()
+            if 'time' not in result:
+                result['time'] = time_end - time_start
+            if 'result' not in result:
                 result['result'] = 'fail'
-                result['exception'] = str(sys.exc_info()[0]) + \
-                    str(sys.exc_info()[1])
-                result['traceback'] = \
-                    "".join(traceback.format_tb(sys.exc_info()[2]))
-
-            status(result['result'])
+            if not isinstance(result, TestResult):
+                result = TestResult(result)
+                result['result'] = 'warn'
+                result['note'] = 'Result not returned as an instance ' \
+                                 'of TestResult'
+        except:
+            result = TestResult()
+            result['result'] = 'fail'
+            result['exception'] = str(sys.exc_info()[0]) + \
+                str(sys.exc_info()[1])
+            result['traceback'] = \
+                "".join(traceback.format_tb(sys.exc_info()[2]))
+
+        status(result['result'])
+        return result
 
-            if 'subtest' in result and len(result['subtest'].keys()) > 1:
-                for test in result['subtest'].keys():
-                    result['result'] = result['subtest'][test]
-                    json_writer.write_dict_item(path + '/' + test, result)
-            else:
-                json_writer.write_dict_item(path, result)
+    def result_items(self, path, result):
+        '''
+        Return the ``(path, TestResult)`` pairs to write for a result, see
+        ``Test.execute``.
+        '''
+        if 'subtest' in result and len(result['subtest'].keys()) > 1:
+            items = []
+            for test in result['subtest'].keys():
+                result['result'] = result['subtest'][test]
+                items.append((path + '/' + test, TestResult(result)))
+            return items
         else:
-            status("dry-run")
+            return [(path, result)]
 
     # Returns True iff the given error message should be ignored
     def isIgnored(self, error):
@@ -550,6 +835,29 @@ class TestProfile:
         # Filter out unwanted tests
         self.test_list = dict(filter(test_matches, self.test_list.items()))
 
+    def ordered_test_list(self, env):
+        '''
+        Return the ``(path, test)`` pairs of the test list in the order
+        they should be started.
+
+        If ``env.timings`` holds durations from an earlier run, the tests
+        are sorted longest first (LPT scheduling), so that a few long tests
+        starting last don't stretch the tail of the run.  Tests without a
+        recorded time are assumed to take the average time.
+        '''
+        items = self.test_list.items()
+        if not env.timings:
+            return items
+
+        known = [env.timings[path] for (path, test) in items
+                 if path in env.timings]
+        if not known:
+            return items
+        default = sum(known) / len(known)
+
+        return sorted(items, key=lambda (path, test):
+                      env.timings.get(path, default), reverse=True)
+
     def run(self, env, json_writer):
         '''
         Schedule all tests in profile for execution.
@@ -558,16 +866,25 @@ class TestProfile:
         '''
 
         self.prepare_test_list(env)
+        test_list = self.ordered_test_list(env)
+
+        if env.execute:
+            for (path, test) in test_list:
+                test.prepare(env)
 
         # Queue up all the concurrent tests, so the pool is filled
         # at the start of the test run.
         if env.concurrent:
-            for (path, test) in self.test_list.items():
+            for (path, test) in test_list:
                 test.schedule(env, path, json_writer)
+            json_writer.file.flush()
+            ConcurrentTestPool().start(env.jobs)
 
         # Run any remaining non-concurrent tests serially from this
-        # thread, while the concurrent tests
-        for (path, test) in self.test_list.items():
+        # thread, while the concurrent tests run in the pool.  They are
+        # also started longest first, so the serial chain overlaps the
+        # pool as much as possible instead of trailing behind it.
+        for (path, test) in test_list:
             if not env.concurrent or not test.runConcurrent:
                 test.doRun(env, path, json_writer)
         ConcurrentTestPool().join()
@@ -616,6 +933,25 @@ def loadTestResults(relativepath):
     return testrun
 
 
+def loadTestTimes(relativepath):
+    '''
+    Return a dict mapping test paths to the time each took in the given
+    results file.
+
+    Tests that were split into subtests are also listed under their own
+    path, so the result can be matched against a test profile.
+    '''
+    times = {}
+    for (path, result) in loadTestResults(relativepath).tests.items():
+        if 'time' not in result:
+            continue
+        times[path] = result['time']
+        if 'subtest' in result:
+            parent = os.path.dirname(path)
+            times[parent] = max(times.get(parent, 0), result['time'])
+    return times
+
+
 # Error messages to be ignored
 Test.ignoreErrors = map(re.compile,
                         ["couldn't open libtxc_dxtn.so",
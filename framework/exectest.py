@@ -20,13 +20,21 @@
 # OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 # DEALINGS IN THE SOFTWARE.
 
+import atexit
+import collections
+import copy
 import errno
 import os
+import select
 import subprocess
 import shlex
+import sys
+import threading
 import types
 
 from core import Test, testBinDir, TestResult
+from threads import ConcurrentTestPool
+import metadata
 
 
 # Platform global variables
@@ -36,13 +44,23 @@ else:
     PIGLIT_PLATFORM = ''
 
 
+class _ListSubtestsFailed(Exception):
+    pass
+
+
 # ExecTest: A shared base class for tests that simply run an executable.
 class ExecTest(Test):
+    # Split the subtests of a concurrent test over up to this many
+    # processes.  The executable must support -list-subtests and
+    # -subtest, see piglit_should_run_subtest().
+    subtest_shards = 0
+
     def __init__(self, command):
         Test.__init__(self)
         self.command = command
         self.split_command = os.path.split(self.command[0])[1]
         self.env = {}
+        self.rusage = None
 
         if isinstance(self.command, basestring):
             self.command = shlex.split(str(self.command))
@@ -76,6 +94,7 @@ class ExecTest(Test):
 
             i = 0
             while True:
+                self.rusage = None
                 if self.skip_test:
                     out = "PIGLIT: {'result': 'skip'}\n"
                     err = ""
@@ -161,6 +180,8 @@ class ExecTest(Test):
                                                              err, out)
             results['returncode'] = returncode
             results['command'] = ' '.join(self.command)
+            if self.rusage is not None:
+                results['rusage'] = self.rusage
 
             self.handleErr(results, err)
 
@@ -171,6 +192,61 @@ class ExecTest(Test):
 
         return results
 
+    def list_subtests(self):
+        """Return the names of the subtests the executable would run.
+
+        Tests are sharded while they are scheduled, before the concurrent
+        pool starts, so the listing is cached in the metadata index under
+        the executable, keyed by its arguments and environment.  It's only
+        run again once the executable changes.
+
+        Returns None if it can't list them.
+        """
+        kind = 'subtests ' + ' '.join(self.command[1:] + [
+            '{0}={1}'.format(e, self.env[e]) for e in sorted(self.env)])
+        try:
+            return metadata.get_index().lookup(kind, self.command[0],
+                                               self.__run_list_subtests)
+        except (OSError, _ListSubtestsFailed):
+            return None
+
+    def __run_list_subtests(self, filepath):
+        fullenv = os.environ.copy()
+        for e in self.env:
+            fullenv[e] = str(self.env[e])
+
+        out, _, returncode = ExecTest.get_command_result(
+            self, self.command + ['-list-subtests'], fullenv)
+        if returncode != 0:
+            # Not stored in the index, it may work next time.
+            raise _ListSubtestsFailed()
+
+        prefix = 'PIGLIT:list-subtest '
+        return [line[len(prefix):] for line in out.splitlines()
+                if line.startswith(prefix)]
+
+    def shards(self):
+        if self.subtest_shards < 2 or self.skip_test:
+            return None
+        names = self.list_subtests()
+        if not names or len(names) < 2:
+            return None
+
+        # Deal the subtests out round robin, so that slow neighbouring
+        # subtests (such as all the variants of one format) are spread
+        # over the shards.
+        count = min(self.subtest_shards, len(names))
+        shards = []
+        for i in xrange(count):
+            shard = copy.copy(self)
+            shard.subtest_shards = 0
+            shard.command = list(self.command)
+            shard.subtests = names[i::count]
+            for name in shard.subtests:
+                shard.command += ['-subtest', name]
+            shards.append(shard)
+        return shards
+
     def check_for_skip_scenario(self, command):
         global PIGLIT_PLATFORM
         if PIGLIT_PLATFORM == 'gbm':
@@ -181,13 +257,21 @@ class ExecTest(Test):
         return False
 
     def get_command_result(self, command, fullenv):
+        """Run command, and return ``(out, err, returncode)``.
+
+        Where the platform can tell, ``self.rusage`` is set to the
+        resources the process used, see ``_rusage_dict``.
+        """
         try:
             proc = subprocess.Popen(command,
                                     stdout=subprocess.PIPE,
                                     stderr=subprocess.PIPE,
                                     env=fullenv,
                                     universal_newlines=True)
-            out, err = proc.communicate()
+            if hasattr(os, 'wait4'):
+                out, err, self.rusage = _communicate_rusage(proc)
+            else:
+                out, err = proc.communicate()
             returncode = proc.returncode
         except OSError as e:
             # Different sets of tests get built under
@@ -205,6 +289,212 @@ class ExecTest(Test):
         return out, err, returncode
 
 
+def _rusage_dict(ru):
+    """Convert a resource.struct_rusage to what is stored in results.
+
+    'utime' and 'stime' are the user and system CPU time in seconds,
+    'maxrss' the peak resident set size in KiB, 'minflt' and 'majflt'
+    the page faults that did not and did need I/O, and 'nvcsw' and
+    'nivcsw' the voluntary and involuntary context switches.
+    """
+    maxrss = ru.ru_maxrss
+    if sys.platform == 'darwin':
+        # Reported in bytes rather than KiB
+        maxrss //= 1024
+    return {'utime': ru.ru_utime,
+            'stime': ru.ru_stime,
+            'maxrss': maxrss,
+            'minflt': ru.ru_minflt,
+            'majflt': ru.ru_majflt,
+            'nvcsw': ru.ru_nvcsw,
+            'nivcsw': ru.ru_nivcsw}
+
+
+def _communicate_rusage(proc):
+    """Like proc.communicate(), but also return what proc used.
+
+    Popen reaps the child with waitpid(), which discards its rusage, and
+    getrusage(RUSAGE_CHILDREN) can't tell apart the children of the
+    concurrent test threads.  So the output is drained here and the child
+    reaped with wait4().
+
+    :return: (out, err, rusage), see _rusage_dict for the latter.
+    """
+    bufs = {proc.stdout.fileno(): [],
+            proc.stderr.fileno(): []}
+    pending = set(bufs.keys())
+
+    while pending:
+        try:
+            ready, _, _ = select.select(list(pending), [], [])
+        except select.error as e:
+            if e.args[0] == errno.EINTR:
+                continue
+            raise
+        for fd in ready:
+            data = os.read(fd, 65536)
+            if data:
+                bufs[fd].append(data)
+            else:
+                pending.remove(fd)
+    # What universal_newlines would have done
+    out, err = [''.join(bufs[f.fileno()]).replace('\r\n', '\n')
+                .replace('\r', '\n') for f in (proc.stdout, proc.stderr)]
+    proc.stdout.close()
+    proc.stderr.close()
+
+    while True:
+        try:
+            _, status, ru = os.wait4(proc.pid, 0)
+            break
+        except OSError as e:
+            if e.errno != errno.EINTR:
+                raise
+    if os.WIFSIGNALED(status):
+        proc.returncode = -os.WTERMSIG(status)
+    else:
+        proc.returncode = os.WEXITSTATUS(status)
+    return out, err, _rusage_dict(ru)
+
+
+class BatchWorker(object):
+    """A long-lived test process running in batch mode.
+
+    shader_runner and glslparsertest support a -batch option, and glean a
+    --batch option: the context (or, for glean, the list of visuals) is
+    set up once, from the command line, and tests are then sent to the
+    process one line at a time over stdin.  The output of each test is
+    read back up to the end marker that the process prints on stdout and
+    stderr after every test.
+    """
+
+    END_MARKER = 'PIGLIT-BATCH-END\n'
+    REJECT_MARKER = 'PIGLIT-BATCH-REJECT'
+
+    def __init__(self, command):
+        self.proc = subprocess.Popen(command,
+                                     stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE,
+                                     stderr=subprocess.PIPE)
+        self.alive = True
+
+    def __read_until_markers(self):
+        """Read stdout and stderr until both have produced END_MARKER.
+
+        Both streams are drained together so that a script with a lot of
+        output on one of them cannot block the worker.
+
+        :return: (out, err, eof) where eof is True if the worker exited.
+        """
+        bufs = {self.proc.stdout.fileno(): '',
+                self.proc.stderr.fileno(): ''}
+        pending = set(bufs.keys())
+
+        while pending:
+            ready, _, _ = select.select(list(pending), [], [])
+            for fd in ready:
+                data = os.read(fd, 65536)
+                if not data:
+                    return (bufs[self.proc.stdout.fileno()],
+                            bufs[self.proc.stderr.fileno()], True)
+                bufs[fd] += data
+                if bufs[fd].endswith(self.END_MARKER):
+                    bufs[fd] = bufs[fd][:-len(self.END_MARKER)]
+                    pending.remove(fd)
+
+        return (bufs[self.proc.stdout.fileno()],
+                bufs[self.proc.stderr.fileno()], False)
+
+    def run(self, line):
+        """Run one test in the worker.
+
+        :return: (out, err, returncode) with the same meaning as
+                 ``ExecTest.get_command_result``, or None if the worker
+                 refused the test because it needs a different context.
+        """
+        try:
+            self.proc.stdin.write(line + '\n')
+            self.proc.stdin.flush()
+        except IOError as e:
+            if e.errno != errno.EPIPE:
+                raise
+            self.alive = False
+            return '', '', self.proc.wait()
+
+        out, err, eof = self.__read_until_markers()
+        if eof:
+            # The worker died while running the test, most likely a
+            # crash.  Report its exit status like a one-shot process.
+            self.alive = False
+            return out, err, self.proc.wait()
+
+        if out.startswith(self.REJECT_MARKER):
+            return None
+
+        # Mirror the exit status that piglit_report_result() would have
+        # used had the test run in a process of its own.
+        if "PIGLIT: {'result': 'fail' }" in out:
+            returncode = 1
+        else:
+            returncode = 0
+        return out, err, returncode
+
+    def close(self):
+        if self.alive:
+            self.proc.stdin.close()
+            self.proc.wait()
+            self.alive = False
+
+
+class BatchWorkerPool(object):
+    """Idle BatchWorkers, keyed by the context they were created for.
+
+    A test thread takes a worker out of the pool for the duration of one
+    test.  At most one idle worker is kept per context.  Every process
+    running tests has a pool of its own, so MAX_IDLE, the number of idle
+    workers kept for the whole run, is shared out between them, keeping
+    at least one each: when a worker is released beyond its process's
+    share, the one idle the longest is closed.
+    """
+
+    MAX_IDLE = 4
+
+    def __init__(self):
+        self.__lock = threading.Lock()
+        # Map from key to its idle worker, least recently used first
+        self.__idle = collections.OrderedDict()
+        atexit.register(self.close)
+
+    def acquire(self, key, command):
+        """Return an idle worker for key, or start one running command."""
+        with self.__lock:
+            worker = self.__idle.pop(key, None)
+        if worker is None:
+            worker = BatchWorker(command)
+        return worker
+
+    def release(self, key, worker):
+        closing = []
+        with self.__lock:
+            if worker.alive and key in self.__idle:
+                closing.append(worker)
+            elif worker.alive:
+                self.__idle[key] = worker
+                limit = max(1, self.MAX_IDLE //
+                            ConcurrentTestPool().processes())
+                while len(self.__idle) > limit:
+                    closing.append(self.__idle.popitem(last=False)[1])
+        for each in closing:
+            each.close()
+
+    def close(self):
+        with self.__lock:
+            idle = self.__idle.values()
+            self.__idle = collections.OrderedDict()
+        for worker in idle:
+            worker.close()
+
+
 class PlainExecTest(ExecTest):
     """
     PlainExecTest: Run a "native" piglit test executable
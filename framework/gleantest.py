@@ -22,9 +22,10 @@
 
 import os
 import subprocess
+import threading
 
 from core import checkDir, testBinDir, Test, TestResult
-from exectest import ExecTest
+from exectest import ExecTest, BatchWorkerPool
 
 
 def gleanExecutable():
@@ -35,12 +36,40 @@ def gleanExecutable():
 class GleanTest(ExecTest):
     globalParams = []
 
+    # If true, tests are run by long-lived glean processes, which
+    # enumerate the visuals and create windows once for all of them,
+    # instead of a process per test.
+    batch_mode = False
+    _pool = None
+    _pool_lock = threading.Lock()
+
     def __init__(self, name):
         ExecTest.__init__(self, [gleanExecutable(),
                                  "-o", "-v", "-v", "-v", "-t",
                                  "+"+name] + GleanTest.globalParams)
         self.name = name
 
+    def get_command_result(self, command, fullenv):
+        # Valgrind runs and tests with their own environment still get a
+        # process of their own.
+        if not GleanTest.batch_mode or command[0] == 'valgrind' or \
+           self.env:
+            return ExecTest.get_command_result(self, command, fullenv)
+
+        with GleanTest._pool_lock:
+            if GleanTest._pool is None:
+                GleanTest._pool = BatchWorkerPool()
+        pool = GleanTest._pool
+
+        key = tuple(GleanTest.globalParams)
+        worker = pool.acquire(key, [gleanExecutable(), "-o", "-v", "-v",
+                                    "-v", "--batch"] + GleanTest.globalParams)
+        try:
+            result = worker.run(self.name)
+        finally:
+            pool.release(key, worker)
+        return result
+
     def interpretResult(self, out, returncode, results):
         if out.find('FAIL') >= 0:
             results['result'] = 'fail'
@@ -37,11 +37,14 @@ import os.path as path
 import re
 import subprocess
 import sys
+import threading
 
+import metadata
+import prefilter
 from ConfigParser import SafeConfigParser
 from core import Test, testBinDir, TestResult
 from cStringIO import StringIO
-from exectest import PlainExecTest
+from exectest import PlainExecTest, BatchWorkerPool
 
 
 def add_glsl_parser_test(group, filepath, test_name):
@@ -63,9 +66,10 @@ def import_glsl_parser_tests(group, basepath, subdirectories):
     is called and the file 'a/b1/c/d.frag' exists, then the test is
     registered into the group as ``group['b1/c/d.frag']``.
     """
+    index = metadata.get_index()
     for d in subdirectories:
         walk_dir = path.join(basepath, d)
-        for (dirpath, dirnames, filenames) in os.walk(walk_dir):
+        for (dirpath, dirnames, filenames) in index.walk(walk_dir):
             # Ignore dirnames.
             for f in filenames:
                 # Add f as a test if its file extension is good.
@@ -188,6 +192,17 @@ class GLSLParserTest(PlainExecTest):
     __config_defaults = {'require_extensions': '',
                          'check_link': 'false'}
 
+    # If true, run the tests in long-lived glslparsertest processes, one
+    # per GLSL version, instead of starting a process for every test.
+    batch_mode = False
+    _pool = None
+    _pool_lock = threading.Lock()
+
+    # When true, tests requiring extensions the context doesn't have are
+    # skipped without starting glslparsertest (see prefilter.py).
+    prefilter_requirements = False
+    _probes = prefilter.ContextProbeCache()
+
     def __init__(self, filepath, runConcurrent=True):
         """
         :filepath: Must end in one '.vert', '.geom', or '.frag'.
@@ -198,18 +213,15 @@ class GLSLParserTest(PlainExecTest):
         self.__filepath = filepath
         self.result = None
 
-    def __get_config(self):
-        """Extract the config section from the test file.
-
-        Set ``self.__cached_config``.  If the config section is missing
-        or invalid, or any other errors occur, then set ``self.result``
-        to failure.
+    @classmethod
+    def __parse_config_section(cls, filepath):
+        """Extract the text of the config section from the test file.
 
-        :return: None
+        :return: A dict, stored in the metadata index, holding either
+                 ``config``, the text of the section, or ``errors`` and
+                 ``note`` describing why it could not be extracted.
         """
 
-        cls = self.__class__
-
         # Text of config section.
         text_io = StringIO()
 
@@ -227,85 +239,101 @@ class GLSLParserTest(PlainExecTest):
         internal = None  # Non-empty line in config body.
         end = None  # Marks end of config body.
 
-        try:
-            f = open(self.__filepath, 'r')
-        except IOError:
-            self.result = TestResult()
-            self.result['result'] = 'fail'
-            self.result['errors'] = \
-                ["Failed to open test file '{0}'".format(self.__filepath)]
-            return
-        for line in f:
-            if parse_state == PARSE_FIND_START:
-                m = start.match(line)
-                if m is not None:
-                    parse_state = PARSE_IN_CONFIG
-                    text_io.write(m.group('content'))
-                    indent = '.' * len(m.group('indent'))
-                    empty = re.compile(r'\A\s*(|//|/\*|\*)\s*\n\Z')
-                    internal = re.compile(r'\A{indent}(?P<content>'
-                                          '.*\n)\Z'.format(indent=indent))
-                    end = re.compile(r'\A{indent}\[end( |_)'
-                                     'config\]\s*\n\Z'.format(indent=indent))
-            elif parse_state == PARSE_IN_CONFIG:
-                if start.match(line) is not None:
+        with open(filepath, 'r') as f:
+            for line in f:
+                if parse_state == PARSE_FIND_START:
+                    m = start.match(line)
+                    if m is not None:
+                        parse_state = PARSE_IN_CONFIG
+                        text_io.write(m.group('content'))
+                        indent = '.' * len(m.group('indent'))
+                        empty = re.compile(r'\A\s*(|//|/\*|\*)\s*\n\Z')
+                        internal = re.compile(r'\A{indent}(?P<content>'
+                                              '.*\n)\Z'.format(indent=indent))
+                        end = re.compile(r'\A{indent}\[end( |_)'
+                                         'config\]\s*\n\Z'.format(
+                                             indent=indent))
+                elif parse_state == PARSE_IN_CONFIG:
+                    if start.match(line) is not None:
+                        parse_state = PARSE_ERROR
+                        break
+                    if end.match(line) is not None:
+                        parse_state = PARSE_DONE
+                        break
+                    m = internal.match(line)
+                    if m is not None:
+                        text_io.write(m.group('content'))
+                        continue
+                    m = empty.match(line)
+                    if m is not None:
+                        text_io.write('\n')
+                        continue
                     parse_state = PARSE_ERROR
                     break
-                if end.match(line) is not None:
-                    parse_state = PARSE_DONE
-                    break
-                m = internal.match(line)
-                if m is not None:
-                    text_io.write(m.group('content'))
-                    continue
-                m = empty.match(line)
-                if m is not None:
-                    text_io.write('\n')
-                    continue
-                parse_state = PARSE_ERROR
-                break
-            else:
-                assert(False)
+                else:
+                    assert(False)
 
+        note = "See the docstring in file '{0}'".format(__file__)
         if parse_state == PARSE_DONE:
-            pass
+            text = text_io.getvalue()
+            text_io.close()
+            return {'config': text}
         elif parse_state == PARSE_FIND_START:
-            self.result = TestResult()
-            self.result['result'] = 'fail'
-            self.result['errors'] = ["Config section of test file '{0}' is "
-                                     "missing".format(self.__filepath)]
-            self.result['errors'] += ["Failed to find initial line of config "
-                                      "section '// [config]'"]
-            self.result['note'] = \
-                "See the docstring in file '{0}'".format(__file__)
-            return
+            return {'errors': ["Config section of test file '{0}' is "
+                               "missing".format(filepath),
+                               "Failed to find initial line of config "
+                               "section '// [config]'"],
+                    'note': note}
         elif parse_state == PARSE_IN_CONFIG:
+            return {'errors': ["Config section of test file '{0}' does "
+                               "not terminate".format(filepath),
+                               "Failed to find terminal line of config "
+                               "section '// [end config]'"],
+                    'note': note}
+        elif parse_state == PARSE_ERROR:
+            return {'errors': ["Config section of test file '{0}' is "
+                               "ill formed, most likely due to "
+                               "whitespace".format(filepath)],
+                    'note': note}
+        else:
+            assert(False)
+
+    def __get_config(self):
+        """Extract the config section from the test file.
+
+        Set ``self.__cached_config``.  If the config section is missing
+        or invalid, or any other errors occur, then set ``self.result``
+        to failure.
+
+        The section is extracted once and then kept in the metadata
+        index.
+
+        :return: None
+        """
+
+        cls = self.__class__
+
+        try:
+            section = metadata.get_index().lookup(
+                'glsl_parser_test', self.__filepath,
+                cls.__parse_config_section)
+        except (IOError, OSError):
             self.result = TestResult()
             self.result['result'] = 'fail'
-            self.result['errors'] = ["Config section of test file '{0}' does "
-                                     "not terminate".format(self.__filepath)]
-            self.result['errors'] += ["Failed to find terminal line of config "
-                                      "section '// [end config]'"]
-            self.result['note'] = \
-                "See the docstring in file '{0}'".format(__file__)
+            self.result['errors'] = \
+                ["Failed to open test file '{0}'".format(self.__filepath)]
             return
-        elif parse_state == PARSE_ERROR:
+
+        if 'errors' in section:
             self.result = TestResult()
             self.result['result'] = 'fail'
-            self.result['errors'] = ["Config section of test file '{0}' is "
-                                     "ill formed, most likely due to "
-                                     "whitespace".format(self.__filepath)]
-            self.result['note'] = \
-                "See the docstring in file '{0}'".format(__file__)
+            self.result['errors'] = list(section['errors'])
+            self.result['note'] = section['note']
             return
-        else:
-            assert(False)
 
         config = ConfigParser.SafeConfigParser(cls.__config_defaults)
         try:
-            text = text_io.getvalue()
-            text_io.close()
-            config.readfp(StringIO(text))
+            config.readfp(StringIO(section['config']))
         except ConfigParser.Error as e:
             self.result = TestResult()
             self.result['result'] = 'fail'
@@ -394,6 +422,55 @@ class GLSLParserTest(PlainExecTest):
     def env(self):
         return dict()
 
+    @staticmethod
+    def __probe_context(key):
+        return GLSLParserTest._probes.get(key, [key[0], '-probe', key[1],
+                                                '-auto'])
+
+    def prepare(self, env):
+        # Probe the context before the worker processes are forked, so
+        # it's probed once per run rather than once per worker.
+        if GLSLParserTest.prefilter_requirements and not env.valgrind and \
+           self.command is not None:
+            self.__probe_context((self.command[0],
+                                  self.config.get('config', 'glsl_version')))
+
+    def get_command_result(self, command, fullenv):
+        # glslparsertest creates its context for the GLSL version, so
+        # that is all a test needs to share a worker or a probe.
+        glsl_version = self.config.get('config', 'glsl_version')
+        key = (command[0], glsl_version)
+
+        if GLSLParserTest.prefilter_requirements and \
+           command[0] != 'valgrind':
+            info = GLSLParserTest.__probe_context(key)
+            if info is not None:
+                reason = prefilter.check_extensions(
+                    self.config.get('config', 'require_extensions').split(),
+                    info)
+                if reason is not None:
+                    return prefilter.skip_output(reason)
+
+        # Valgrind runs still get a process of their own.
+        if not GLSLParserTest.batch_mode or command[0] == 'valgrind':
+            return PlainExecTest.get_command_result(self, command, fullenv)
+
+        with GLSLParserTest._pool_lock:
+            if GLSLParserTest._pool is None:
+                GLSLParserTest._pool = BatchWorkerPool()
+        pool = GLSLParserTest._pool
+
+        worker = pool.acquire(key, [command[0], '-batch', glsl_version,
+                                    '-auto'])
+        try:
+            result = worker.run(' '.join(command[1:]))
+        finally:
+            pool.release(key, worker)
+
+        if result is None:
+            return PlainExecTest.get_command_result(self, command, fullenv)
+        return result
+
 if __name__ == '__main__':
     if len(sys.argv) != 2:
         sys.stderr.write("{0}: usage error\n\n".format(sys.argv[0]))
@@ -0,0 +1,218 @@
+# Copyright (c) 2013 The Piglit project
+#
+# Permission is hereby granted, free of charge, to any person
+# obtaining a copy of this software and associated documentation
+# files (the "Software"), to deal in the Software without
+# restriction, including without limitation the rights to use,
+# copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following
+# conditions:
+#
+# This permission notice shall be included in all copies or
+# substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+# KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+# WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+# PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHOR(S) BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+# AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+# OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+"""Cache of the metadata that test classes parse out of test files.
+
+ShaderTest needs the [require] block of every .shader_test and
+GLSLParserTest the [config] section of every parser test, sharded
+ExecTests the subtests their executable lists, and profiles
+walk large directory trees to find them.  On a slow file system, opening
+and scanning thousands of files dominates the start of a run.
+
+The index remembers, for each file, what was parsed out of it, and for
+each directory, its listing.  An entry is reused for as long as the
+file's (or directory's) mtime and size are unchanged, so a warm index
+replaces the reads with one stat() per file.
+"""
+
+import atexit
+import errno
+import json
+import os
+import os.path as path
+import tempfile
+import threading
+
+__all__ = ['TestMetadataIndex',
+           'open_index',
+           'get_index',
+           'default_index_path']
+
+
+def default_index_path():
+    """Return the default location of the index file."""
+    cache_home = os.environ.get('XDG_CACHE_HOME',
+                                path.join(path.expanduser('~'), '.cache'))
+    return path.join(cache_home, 'piglit', 'metadata-index.json')
+
+
+class TestMetadataIndex(object):
+    """Metadata parsed from test files, keyed by path and modification time.
+
+    If ``filename`` is None the index only lives in memory, which still
+    spares parsing a file twice within one process.
+    """
+
+    # Bump when the layout of the file, or of the data stored by any
+    # parser, changes.  Files written with another version are ignored.
+    VERSION = 1
+
+    def __init__(self, filename=None):
+        self.filename = filename
+        self.__files = {}
+        self.__dirs = {}
+        self.__dirty = False
+        self.__lock = threading.Lock()
+
+        if filename is None:
+            return
+        try:
+            with open(filename, 'r') as f:
+                data = json.load(f)
+        except IOError as e:
+            if e.errno != errno.ENOENT:
+                raise
+            return
+        except ValueError:
+            # A corrupt index is only a cold cache.
+            return
+        if data.get('version') == self.VERSION:
+            self.__files = data['files']
+            self.__dirs = data['dirs']
+
+    @staticmethod
+    def __stamp(st):
+        return [st.st_mtime, st.st_size]
+
+    def lookup(self, kind, filepath, parser):
+        """Return the ``kind`` metadata of ``filepath``.
+
+        ``parser(filepath)`` is called, and its result stored, only if the
+        index has no entry for the file or the file changed since.  The
+        result must be JSON serializable.  ``kind`` names the parser, so
+        different test classes can index the same file.
+
+        Raises OSError if the file cannot be stat'ed.
+        """
+        key = path.abspath(filepath)
+        stamp = self.__stamp(os.stat(filepath))
+
+        with self.__lock:
+            entry = self.__files.get(key)
+            if entry is not None and entry[0] == stamp and kind in entry[1]:
+                return entry[1][kind]
+
+        data = parser(filepath)
+
+        with self.__lock:
+            entry = self.__files.get(key)
+            if entry is None or entry[0] != stamp:
+                entry = [stamp, {}]
+                self.__files[key] = entry
+            entry[1][kind] = data
+            self.__dirty = True
+        return data
+
+    def listdir(self, dirpath):
+        """Return ``(dirnames, filenames)`` for the entries of ``dirpath``.
+
+        Both lists are sorted.  Raises OSError if the directory cannot
+        be read.
+        """
+        key = path.abspath(dirpath)
+        stamp = self.__stamp(os.stat(dirpath))
+
+        with self.__lock:
+            entry = self.__dirs.get(key)
+            if entry is not None and entry[0] == stamp:
+                return entry[1], entry[2]
+
+        dirnames = []
+        filenames = []
+        for name in sorted(os.listdir(dirpath)):
+            if path.isdir(path.join(dirpath, name)):
+                dirnames.append(name)
+            else:
+                filenames.append(name)
+
+        with self.__lock:
+            self.__dirs[key] = [stamp, dirnames, filenames]
+            self.__dirty = True
+        return dirnames, filenames
+
+    def walk(self, top):
+        """Like os.walk(top), but reading listings through the index.
+
+        Directories that cannot be read are skipped, as os.walk does.
+        """
+        try:
+            dirnames, filenames = self.listdir(top)
+        except OSError:
+            return
+        yield top, dirnames, filenames
+        for name in dirnames:
+            for entry in self.walk(path.join(top, name)):
+                yield entry
+
+    def save(self):
+        """Write the index back to its file, if anything changed.
+
+        The file is replaced atomically, so concurrent runs sharing an
+        index at worst lose each other's additions.
+        """
+        with self.__lock:
+            if self.filename is None or not self.__dirty:
+                return
+            text = json.dumps({'version': self.VERSION,
+                               'files': self.__files,
+                               'dirs': self.__dirs})
+            self.__dirty = False
+
+        dirname = path.dirname(path.abspath(self.filename))
+        try:
+            if not path.isdir(dirname):
+                os.makedirs(dirname)
+            fd, tmpname = tempfile.mkstemp(dir=dirname,
+                                           prefix='.metadata-index')
+            with os.fdopen(fd, 'w') as f:
+                f.write(text)
+            os.rename(tmpname, self.filename)
+        except (IOError, OSError) as e:
+            # Not being able to write the cache must not fail the run.
+            print 'Warning: could not write metadata index {0}: {1}'.format(
+                self.filename, e)
+
+
+_index = None
+_index_lock = threading.Lock()
+
+
+def open_index(filename):
+    """Make the index stored in ``filename`` the one used by test classes.
+
+    The index is written back when the process exits.
+    """
+    global _index
+    with _index_lock:
+        _index = TestMetadataIndex(filename)
+        atexit.register(_index.save)
+    return _index
+
+
+def get_index():
+    """Return the index in use, an in-memory one if none was opened."""
+    global _index
+    with _index_lock:
+        if _index is None:
+            _index = TestMetadataIndex()
+        return _index
@@ -0,0 +1,224 @@
+# Copyright (c) 2013 The Piglit project
+#
+# Permission is hereby granted, free of charge, to any person
+# obtaining a copy of this software and associated documentation
+# files (the "Software"), to deal in the Software without
+# restriction, including without limitation the rights to use,
+# copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following
+# conditions:
+#
+# This permission notice shall be included in all copies or
+# substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+# KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+# WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+# PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHOR(S) BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+# AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+# OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+"""Skip tests whose requirements the driver can't meet without running them.
+
+shader_runner and glslparsertest only find out that a test must be
+skipped after they started and created a context.  With ``-probe``, they
+instead print what the context offers: its versions, limits and
+extensions.  Each context is probed once per run, and the requirements
+of every test using it, taken from the metadata index, are checked
+here.
+
+Only requirements that would certainly make the test skip are acted on.
+Anything this module doesn't understand, and any context that couldn't be
+probed, leaves the decision to the test itself.
+"""
+
+import operator
+import re
+import subprocess
+import threading
+
+__all__ = ['ContextInfo',
+           'ContextProbeCache',
+           'check_shader_test_requirements',
+           'check_extensions',
+           'skip_output']
+
+
+class ContextInfo(object):
+    """What a context supports, parsed from the output of ``-probe``.
+
+    ``versions`` maps 'GL' and 'GLSL' to ``(es, number, text)`` tuples,
+    numbered like shader_runner does: 30 for GL 3.0, 130 for GLSL 1.30.
+    ``limits`` maps the names of GL_MAX_* queries to their values.
+    """
+
+    def __init__(self, output):
+        self.versions = {}
+        self.limits = {}
+        self.extensions = None
+
+        for line in output.splitlines():
+            name, sep, value = line.partition(':')
+            if not sep:
+                continue
+            value = value.strip()
+            if name in ('GL', 'GLSL'):
+                version = _parse_version(name, value)
+                if version is not None:
+                    self.versions[name] = version
+            elif name in _LIMITS:
+                self.limits[name] = int(value)
+            elif name == 'extensions':
+                self.extensions = frozenset(value.split())
+
+    @property
+    def valid(self):
+        return self.extensions is not None
+
+
+class ContextProbeCache(object):
+    """ContextInfo for each context, probed the first time it's needed.
+
+    Tests that would run in the same context share a ``key``.  A probe
+    that fails is remembered as None, so it's not retried for every test.
+
+    The tests fill the cache from ``Test.prepare``, before the concurrent
+    test pool forks, so the workers find their contexts already probed.
+    """
+
+    def __init__(self):
+        self.__infos = {}
+        self.__lock = threading.Lock()
+
+    def get(self, key, command):
+        with self.__lock:
+            if key not in self.__infos:
+                self.__infos[key] = self.__probe(command)
+            return self.__infos[key]
+
+    @staticmethod
+    def __probe(command):
+        try:
+            proc = subprocess.Popen(command,
+                                    stdout=subprocess.PIPE,
+                                    stderr=subprocess.PIPE,
+                                    universal_newlines=True)
+            out, _ = proc.communicate()
+        except OSError:
+            return None
+        if proc.returncode != 0:
+            return None
+
+        info = ContextInfo(out)
+        return info if info.valid else None
+
+
+_COMPARISONS = {'==': operator.eq,
+                '!=': operator.ne,
+                '<': operator.lt,
+                '<=': operator.le,
+                '>': operator.gt,
+                '>=': operator.ge}
+
+# The limits process_requirement() in shader_runner.c can check.  Other
+# names starting with GL_ are extensions.
+_LIMITS = ('GL_MAX_FRAGMENT_UNIFORM_COMPONENTS',
+           'GL_MAX_VERTEX_UNIFORM_COMPONENTS')
+
+_RE_VERSION = re.compile(r'\A( ES)?\s*(\d+)\.(\d+)\Z')
+_RE_VERSION_REQUIREMENT = \
+    re.compile(r'\A( ES)?\s*(==|!=|<=|>=|<|>)\s*(\d+)\.(\d+)\Z')
+_RE_LIMIT_REQUIREMENT = re.compile(r'\A\s*(==|!=|<=|>=|<|>)\s*(-?\d+)')
+
+
+def _version_number(tag, major, minor):
+    # All GL versions look like 3.2, and become 32.  All GLSL versions
+    # look like 1.40, and become 140.
+    if tag == 'GLSL':
+        return int(major) * 100 + int(minor)
+    return int(major) * 10 + int(minor)
+
+
+def _parse_version(tag, text):
+    """Parse a version as printed by -probe, e.g. 'GL ES 3.0'."""
+    if not text.startswith(tag):
+        return None
+    m = _RE_VERSION.match(text[len(tag):])
+    if m is None:
+        return None
+    return (m.group(1) is not None,
+            _version_number(tag, m.group(2), m.group(3)),
+            text)
+
+
+def check_shader_test_requirements(requirements, info):
+    """Check the [require] lines of a shader test against a context.
+
+    Follows process_requirement() in shader_runner.c.
+
+    :return: The reason the test would skip, or None if it might not.
+    """
+    for line in requirements:
+        limit = [name for name in _LIMITS if line.startswith(name)]
+        if limit:
+            name = limit[0]
+            m = _RE_LIMIT_REQUIREMENT.match(line[len(name):])
+            if m is None or name not in info.limits:
+                return None
+            cmp, value = m.groups()
+            if not _COMPARISONS[cmp](info.limits[name], int(value)):
+                return 'Test requires {0}.  The driver supports ' \
+                       '{1}.'.format(line, info.limits[name])
+        elif line.startswith('GL_'):
+            extension = line.split()[0]
+            if extension not in info.extensions:
+                return 'Test requires {0}'.format(extension)
+        elif line.startswith('!GL_'):
+            extension = line.split()[0][1:]
+            if extension in info.extensions:
+                return 'Test requires {0} to be unsupported'.format(
+                    extension)
+        elif line.startswith('GL'):
+            tag = 'GLSL' if line.startswith('GLSL') else 'GL'
+            m = _RE_VERSION_REQUIREMENT.match(line[len(tag):])
+            if m is None or tag not in info.versions:
+                # shader_runner fails the test instead.
+                return None
+            es, cmp, major, minor = m.groups()
+            if tag == 'GLSL' and cmp != '>=':
+                return None
+
+            number = _version_number(tag, major, minor)
+            actual_es, actual_number, actual_text = info.versions[tag]
+            if (es is not None) != actual_es or \
+               not _COMPARISONS[cmp](actual_number, number):
+                return 'Test requires {0}.  Actual version is {1}.'.format(
+                    line, actual_text)
+    return None
+
+
+def check_extensions(extensions, info):
+    """Check the extensions a GLSL parser test requires against a context.
+
+    Follows glslparsertest, where a leading '!' requires the extension
+    to be unsupported.
+
+    :return: The reason the test would skip, or None if it might not.
+    """
+    for extension in extensions:
+        if extension.startswith('!'):
+            if extension[1:] in info.extensions:
+                return 'Test requires {0} to be unsupported'.format(
+                    extension[1:])
+        elif extension not in info.extensions:
+            return 'Test requires {0}'.format(extension)
+    return None
+
+
+def skip_output(reason):
+    """Return ``(out, err, returncode)`` as if the test reported skip."""
+    return ("PIGLIT: {'result': 'skip' }\n" + reason + "\n" +
+            "Skipped by the requirement prefilter.\n", "", 0)
@@ -28,11 +28,15 @@ import os
 import os.path
 import os.path as path
 import re
+import subprocess
 import sys
 import textwrap
+import threading
 
+import metadata
+import prefilter
 from core import testBinDir, Group, Test, TestResult
-from exectest import PlainExecTest
+from exectest import PlainExecTest, BatchWorkerPool
 
 """This module enables running shader tests.
 
@@ -64,23 +68,38 @@ def add_shader_test(group, testname, filepath):
 
 def add_shader_test_dir(group, dirpath, recursive=False):
     """Add all shader tests in a directory to the given group."""
-    for filename in os.listdir(dirpath):
-        filepath = path.join(dirpath, filename)
-        if path.isdir(filepath):
-            if not recursive:
-                continue
-            if not filename in group:
-                group[filename] = Group()
-            add_shader_test_dir(group[filename], filepath, recursive)
-        else:
-            ext = filename.rsplit('.')[-1]
-            if ext != 'shader_test':
-                continue
-            testname = filename[0:-(len(ext) + 1)]  # +1 for '.'
-            add_shader_test(group, testname, filepath)
+    dirnames, filenames = metadata.get_index().listdir(dirpath)
+    if recursive:
+        for dirname in dirnames:
+            if not dirname in group:
+                group[dirname] = Group()
+            add_shader_test_dir(group[dirname], path.join(dirpath, dirname),
+                                recursive)
+    for filename in filenames:
+        ext = filename.rsplit('.')[-1]
+        if ext != 'shader_test':
+            continue
+        testname = filename[0:-(len(ext) + 1)]  # +1 for '.'
+        add_shader_test(group, testname, path.join(dirpath, filename))
 
 
 class ShaderTest(PlainExecTest):
+    # When true, scripts are run by a pool of long-lived shader_runner
+    # processes (see exectest.BatchWorkerPool) instead of a process per test.
+    batch_mode = False
+    _pool = None
+    _pool_lock = threading.Lock()
+
+    # When true, scripts whose requirements the context can't meet are
+    # skipped without starting shader_runner (see prefilter.py).
+    prefilter_requirements = False
+    _probes = prefilter.ContextProbeCache()
+
+    # When non-zero, shader_runner times this many runs of each test's
+    # [test] section after running it, and reports the timings in the
+    # result's 'measurements'.
+    bench_iterations = 0
+
     API_ERROR = 0
     API_GL = 1
     API_GLES2 = 2
@@ -124,6 +143,7 @@ class ShaderTest(PlainExecTest):
         cls.__re_gles3 = re.compile(r'^\s*GL ES\s*{cmp}\s*{gles3_version}'
                                     '\s*{comment}?$'.format(**common))
         cls.__re_gl_unknown = re.compile(r'^\s*GL\s*{cmp}'.format(**common))
+        cls.__re_version_requirement = re.compile(r'^\s*GL(SL)?(\s|ES|<|>|=)')
 
     def __init__(self, shader_runner_args, run_standalone=False):
         """run_standalone: Run the test outside the Python framework."""
@@ -140,6 +160,7 @@ class ShaderTest(PlainExecTest):
         self.__result = None
         self.__command = None
         self.__gl_api = None
+        self.__metadata = None
 
         self.env = {}
 
@@ -156,69 +177,80 @@ class ShaderTest(PlainExecTest):
     def __parse_test_file(self):
         self.__set_gl_api()
 
+    @classmethod
+    def __parse_require_block(cls, filepath):
+        """Parse the requirement block of a shader test.
+
+        :return: A dict, stored in the metadata index, with the keys
+                 ``gl_api``, the API the test needs, ``error``, a message
+                 if the GL requirement cannot be parsed, else None, and
+                 ``require``, the lines of the block stripped of
+                 comments.
+        """
+        cls.__compile_regexes()
+
+        PARSE_FIND_REQUIRE_HEADER = 0
+        PARSE_IN_REQUIRE_BLOCK = 1
+
+        parse_state = PARSE_FIND_REQUIRE_HEADER
+        requirements = {'gl_api': None, 'error': None, 'require': []}
+
+        with open(filepath) as f:
+            for line in f:
+                if parse_state == PARSE_FIND_REQUIRE_HEADER:
+                    if cls.__re_require_header.match(line) is not None:
+                        parse_state = PARSE_IN_REQUIRE_BLOCK
+                    continue
+
+                if requirements['gl_api'] is None:
+                    if cls.__re_gl.match(line) is not None:
+                        requirements['gl_api'] = ShaderTest.API_GL
+                    elif cls.__re_gles2.match(line) is not None:
+                        requirements['gl_api'] = ShaderTest.API_GLES2
+                    elif cls.__re_gles3.match(line) is not None:
+                        requirements['gl_api'] = ShaderTest.API_GLES3
+                    elif cls.__re_gl_unknown.match(line) is not None:
+                        requirements['gl_api'] = ShaderTest.API_ERROR
+                        requirements['error'] = ("Failed to parse GL "
+                                             "requirement: " + line)
+
+                if cls.__re_end_require_block.match(line):
+                    break
+
+                requirement = line.split('#')[0].strip()
+                if requirement:
+                    requirements['require'].append(requirement)
+
+        # If no requirements are found, then assume the required API is
+        # GL. This matches the behavior of the shader_runner executable,
+        # whose default requirements are GL >= 1.0 and GLSL >= 1.10.
+        if requirements['gl_api'] is None:
+            requirements['gl_api'] = ShaderTest.API_GL
+        return requirements
+
     def __set_gl_api(self):
-        """Set self.__gl_api by parsing the test's requirement block.
+        """Set self.__gl_api from the test's requirement block.
 
+        The block is parsed once and then kept in the metadata index.
         This function is idempotent."""
 
         if self.__gl_api is not None:
             return
 
-        cls = self.__class__
-        cls.__compile_regexes()
-
-        PARSE_FIND_REQUIRE_HEADER = 0
-        PARSE_FIND_GL_REQUIREMENT = 1
-
-        parse_state = PARSE_FIND_REQUIRE_HEADER
-
         try:
-            with open(self.__test_filepath) as f:
-                for line in f:
-                    if parse_state == PARSE_FIND_REQUIRE_HEADER:
-                        if cls.__re_require_header.match(line) is not None:
-                            parse_state = PARSE_FIND_GL_REQUIREMENT
-                        else:
-                            continue
-                    elif parse_state == PARSE_FIND_GL_REQUIREMENT:
-                        if cls.__re_gl.match(line) is not None:
-                            self.__gl_api = ShaderTest.API_GL
-                            return
-                        elif cls.__re_gles2.match(line) is not None:
-                            self.__gl_api = ShaderTest.API_GLES2
-                            return
-                        elif cls.__re_gles3.match(line) is not None:
-                            self.__gl_api = ShaderTest.API_GLES3
-                            return
-                        elif cls.__re_gl_unknown.match(line) is not None:
-                            self.__report_failure("Failed to parse GL "
-                                                  "requirement: " + line)
-                            self.__gl_api = ShaderTest.API_ERROR
-                            return
-                        elif cls.__re_end_require_block.match(line):
-                            # Default to GL if no API is given.
-                            self.__gl_api = ShaderTest.API_GL
-                            return
-                        else:
-                            continue
-                    else:
-                        assert(False)
-
-                if parse_state == PARSE_FIND_REQUIRE_HEADER or \
-                   parse_state == PARSE_FIND_GL_REQUIREMENT:
-                    # If no requirements are found, then assume the required
-                    # API is GL. This matches the behavior of the
-                    # shader_runner executable, whose default requirements are
-                    # GL >= 1.0 and GLSL >= 1.10.
-                    self.__gl_api = ShaderTest.API_GL
-                else:
-                    assert(False)
-
-        except IOError:
-            self._report_failure("Failed to read test file "
-                                 "{0!r}".format(self.__test_filepath))
+            self.__metadata = metadata.get_index().lookup(
+                'shader_test', self.__test_filepath,
+                self.__parse_require_block)
+        except (IOError, OSError):
+            self.__report_failure("Failed to read test file "
+                                  "{0!r}".format(self.__test_filepath))
+            self.__gl_api = ShaderTest.API_ERROR
             return
 
+        self.__gl_api = self.__metadata['gl_api']
+        if self.__metadata['error'] is not None:
+            self.__report_failure(self.__metadata['error'])
+
     @property
     def command(self):
         if self.__command is not None:
@@ -241,8 +273,88 @@ class ShaderTest(PlainExecTest):
 
         runner = os.path.join(testBinDir, runner)
         self.__command = [runner] + self.__shader_runner_args
+        if ShaderTest.bench_iterations > 0:
+            self.__command += ['-bench', str(ShaderTest.bench_iterations)]
         return self.__command
 
+    def __context_key(self):
+        """Return a key identifying the context the test runs in.
+
+        shader_runner chooses the context from the GL and GLSL version
+        requirements, so tests with identical version requirement lines
+        can share a batch worker.
+        """
+        cls = self.__class__
+        key = [self.command[0]]
+        for requirement in self.__metadata['require']:
+            if cls.__re_version_requirement.match(requirement):
+                key.append(requirement)
+        return tuple(key)
+
+    def __probe_context(self):
+        return ShaderTest._probes.get(self.__context_key(),
+                                      [self.command[0], self.__test_filepath,
+                                       '-auto', '-probe'])
+
+    def __prefilterable(self):
+        """Return whether the test's requirements can be prefiltered.
+
+        A test whose file couldn't be read or parsed has no requirements
+        to check, and keeps the failure it reports.
+        """
+        self.__set_gl_api()
+        return self.__result is None and self.__metadata is not None
+
+    def prepare(self, env):
+        # Probe the context before the worker processes are forked, so
+        # it's probed once per run rather than once per worker.
+        if ShaderTest.prefilter_requirements and not env.valgrind and \
+           not self.skip_test and not self.env and self.__prefilterable():
+            self.__probe_context()
+
+    def __prefilter_reason(self):
+        """Return why the script would skip in its context, or None."""
+        info = self.__probe_context()
+        if info is None:
+            return None
+        return prefilter.check_shader_test_requirements(
+            self.__metadata['require'], info)
+
+    def get_command_result(self, command, fullenv):
+        # The context is probed without the test's environment, which
+        # could change what it supports.
+        if ShaderTest.prefilter_requirements and \
+           command[0] != 'valgrind' and not self.env and \
+           self.__prefilterable():
+            reason = self.__prefilter_reason()
+            if reason is not None:
+                return prefilter.skip_output(reason)
+
+        # Valgrind runs, benchmarks and tests with extra arguments or
+        # environment still get a process of their own.
+        if not ShaderTest.batch_mode or command[0] == 'valgrind' or \
+           ShaderTest.bench_iterations > 0 or \
+           self.env or self.__shader_runner_args[1:] != ['-auto']:
+            return PlainExecTest.get_command_result(self, command, fullenv)
+
+        with ShaderTest._pool_lock:
+            if ShaderTest._pool is None:
+                ShaderTest._pool = BatchWorkerPool()
+        pool = ShaderTest._pool
+
+        key = self.__context_key()
+        worker = pool.acquire(key, [self.command[0], self.__test_filepath,
+                                    '-auto', '-batch'])
+        try:
+            result = worker.run(self.__test_filepath)
+        finally:
+            pool.release(key, worker)
+
+        if result is None:
+            # The batch worker can't run this script in its context.
+            return PlainExecTest.get_command_result(self, command, fullenv)
+        return result
+
     def run(self, valgrind=False):
         """ Parse the test file's [require] block to determine which
         executable is needed to run the test. Then run the executable on the
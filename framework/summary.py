@@ -20,14 +20,18 @@
 # DEALINGS IN THE SOFTWARE.
 
 import os
+import re
 import os.path as path
 import string
+import hashlib
+import multiprocessing
 from itertools import izip_longest
 from shutil import copy
-from json import loads
+from json import loads, dumps
 from mako.template import Template
 
 import core
+import timing
 
 __all__ = [
     'Summary',
@@ -52,6 +56,86 @@ class Result(core.TestrunResult):
                 result = self.parseFile(file)
 
 
+def _test_page_template():
+    return Template(filename="templates/test_result.mako",
+                    output_encoding="utf-8",
+                    module_directory=".makotmp")
+
+
+def _init_test_page_worker():
+    """
+    Pool initializer for _render_test_page, each worker process loads its own
+    copy of the (already compiled) test page template.
+    """
+    global _testfile
+    _testfile = _test_page_template()
+
+
+def _render_test_page(job):
+    """
+    Render one test page into its destination file, and into the page cache
+    if there is one. job is a (filename, cachefile, render arguments) tuple.
+    """
+    filename, cachefile, args = job
+    page = _testfile.render(**args)
+
+    with open(filename, 'w') as file:
+        file.write(page)
+
+    if cachefile:
+        # Write to a temporary file and rename it so that an interrupted
+        # run never leaves a partial page in the cache
+        tmpfile = "%s.%d.tmp" % (cachefile, os.getpid())
+        with open(tmpfile, 'w') as file:
+            file.write(page)
+        os.rename(tmpfile, cachefile)
+
+
+# Name of a page in the test page cache: the sha1 of what it renders
+_RE_CACHED_PAGE = re.compile(r'\A[0-9a-f]{40}\.html\Z')
+
+
+def _prune_page_cache(cache, used):
+    """
+    Bound the size of the test page cache: keep the pages in used, which
+    this summary needed, and at most as many others, the most recently
+    used first. Pages are touched when they are reused, so their mtime
+    tells when they were last used.
+    """
+    others = []
+    for name in os.listdir(cache):
+        # Only touch the pages generateHTML() writes, the cache directory
+        # may be shared with anything else.
+        if not _RE_CACHED_PAGE.match(name):
+            continue
+        filename = path.join(cache, name)
+        if filename in used or not path.isfile(filename):
+            continue
+        try:
+            others.append((path.getmtime(filename), filename))
+        except OSError:
+            # Removed by a summary running concurrently
+            continue
+
+    others.sort(reverse=True)
+    for _, filename in others[len(used):]:
+        try:
+            os.remove(filename)
+        except OSError:
+            pass
+
+
+def _format_rusage(rusage):
+    """Describe the 'rusage' of a test result on its page."""
+    if rusage is None:
+        return 'None'
+    return ("user %(utime).3fs, system %(stime).3fs, "
+            "peak RSS %(maxrss)d KiB, "
+            "page faults %(minflt)d minor / %(majflt)d major, "
+            "context switches %(nvcsw)d voluntary / %(nivcsw)d involuntary"
+            % rusage)
+
+
 class HTMLIndex(list):
     """
     Builds HTML output to be passed to the index mako template, which will be
@@ -485,7 +569,7 @@ class Summary:
         for test in self.results[-1].tests.values():
             self.totals[test['result']] += 1
 
-    def generateHTML(self, destination, exclude):
+    def generateHTML(self, destination, exclude, jobs=None, cache=None):
         """
         Produce HTML summaries.
 
@@ -494,6 +578,16 @@ class Summary:
         The beauty of this approach is that mako is leveraged to do the
         heavy lifting, this method just passes it a bunch of dicts and lists
         of dicts, which mako turns into pretty HTML.
+
+        The individual test pages make up nearly all of the output, so they
+        are rendered by a pool of jobs worker processes (one per CPU by
+        default). If cache is a directory, each rendered test page is stored
+        there keyed by a hash of the template and everything rendered into
+        the page, and pages that are already in the cache are linked into
+        place instead of being rendered again. Pages link to the style sheet
+        and index by relative paths, so they can be reused by summaries
+        written to other destinations. Afterwards, the cache is pruned to
+        the pages this summary used and as many recently used others.
         """
 
         # Copy static files
@@ -505,14 +599,26 @@ class Summary:
                              output_encoding="utf-8",
                              module_directory=".makotmp")
 
-        # Create the mako object for the individual result files
-        testfile = Template(filename="templates/test_result.mako",
-                            output_encoding="utf-8",
-                            module_directory=".makotmp")
+        # Create the mako object for the individual result files. This also
+        # compiles the template into .makotmp before the workers load it.
+        _test_page_template()
+
+        # Any change to the template invalidates every cached page
+        if cache:
+            if not path.exists(cache):
+                os.makedirs(cache)
+            with open("templates/test_result.mako", 'r') as file:
+                template_hash = hashlib.sha1(file.read()).hexdigest()
 
         resultCss = path.join(destination, "result.css")
         index = path.join(destination, "index.html")
 
+        # Test pages that have to be rendered
+        renderjobs = []
+
+        # Cache files of the test pages
+        cachefiles = set()
+
         # Iterate across the tests creating the various test specific files
         for each in self.results:
             os.mkdir(path.join(destination, each.name))
@@ -536,20 +642,47 @@ class Summary:
                     if not path.exists(tPath):
                         os.makedirs(tPath)
 
-                    file = open(path.join(destination,
-                                          each.name,
-                                          key + ".html"), 'w')
-                    file.write(testfile.render(
-                        testname=key,
-                        status=value.get('result', 'None'),
-                        returncode=value.get('returncode', 'None'),
-                        time=value.get('time', 'None'),
-                        info=value.get('info', 'None'),
-                        traceback=value.get('traceback', 'None'),
-                        command=value.get('command', 'None'),
-                        css=path.relpath(resultCss, tPath),
-                        index=index))
-                    file.close()
+                    filename = path.join(destination, each.name,
+                                         key + ".html")
+                    args = dict(testname=key,
+                                status=value.get('result', 'None'),
+                                returncode=value.get('returncode', 'None'),
+                                time=value.get('time', 'None'),
+                                rusage=_format_rusage(value.get('rusage')),
+                                info=value.get('info', 'None'),
+                                traceback=value.get('traceback', 'None'),
+                                command=value.get('command', 'None'),
+                                css=path.relpath(resultCss, tPath),
+                                index=path.relpath(index, tPath))
+
+                    cachefile = None
+                    if cache:
+                        digest = hashlib.sha1(dumps([template_hash, args],
+                                                    sort_keys=True))
+                        cachefile = path.join(cache,
+                                              digest.hexdigest() + ".html")
+                        cachefiles.add(cachefile)
+                        if path.exists(cachefile):
+                            # Mark the page as recently used
+                            os.utime(cachefile, None)
+                            try:
+                                os.link(cachefile, filename)
+                            except OSError:
+                                copy(cachefile, filename)
+                            continue
+
+                    renderjobs.append((filename, cachefile, args))
+
+        if renderjobs:
+            pool = multiprocessing.Pool(jobs, _init_test_page_worker)
+            for _ in pool.imap_unordered(_render_test_page, renderjobs,
+                                         chunksize=64):
+                pass
+            pool.close()
+            pool.join()
+
+        if cache:
+            _prune_page_cache(cache, cachefiles)
 
         # Finally build the root html files: index, regressions, etc
         index = Template(filename="templates/index.mako",
@@ -570,13 +703,17 @@ class Summary:
 
         self.__generate_lists(pages)
 
+        # The timing page isn't a list of tests, but is linked from all the
+        # others
+        links = pages + ['timing']
+
         # Index.html is a bit of a special case since there is index, all, and
         # alltests, where the other pages all use the same name. ie,
         # changes.html, self.changes, and page=changes.
         file = open(path.join(destination, "index.html"), 'w')
         file.write(index.render(results=HTMLIndex(self, self.tests['all']),
                                 page='all',
-                                pages=pages,
+                                pages=links,
                                 colnum=len(self.results),
                                 exclude=exclude))
         file.close()
@@ -588,16 +725,45 @@ class Summary:
             if self.tests[page]:
                 file.write(index.render(results=HTMLIndex(self,
                                                           self.tests[page]),
-                                        pages=pages,
+                                        pages=links,
                                         page=page,
                                         colnum=len(self.results),
                                         exclude=exclude))
             # otherwise provide an empty page
             else:
-                file.write(empty_status.render(page=page, pages=pages))
+                file.write(empty_status.render(page=page, pages=links))
 
             file.close()
 
+        # The slowest and most slowed down tests and groups
+        timing_page = Template(filename="templates/timing.mako",
+                               output_encoding="utf-8",
+                               module_directory=".makotmp")
+        tests, groups = self.compare_times()
+        usage_tests, usage_groups = self.resource_usage()
+        with open(path.join(destination, "timing.html"), 'w') as file:
+            file.write(timing_page.render(names=[r.name for r in self.results],
+                                          tests=tests,
+                                          groups=groups,
+                                          usage_tests=usage_tests,
+                                          usage_groups=usage_groups,
+                                          pages=links))
+
+    def compare_times(self):
+        """
+        Compare the time each test, and each group of tests, took in the
+        last set of results to the earlier ones. See timing.compare_times().
+        """
+        return timing.compare_times([each.tests for each in self.results])
+
+    def resource_usage(self):
+        """
+        Add up the CPU time, memory, page faults and context switches of
+        each test and group of tests in the last set of results. See
+        timing.resource_usage().
+        """
+        return timing.resource_usage(self.results[-1].tests)
+
     def generateText(self, diff, summary):
         self.__find_totals()
 
@@ -629,5 +795,8 @@ class Summary:
             print "    changes: %d" % len(self.tests['changes'])
             print "      fixes: %d" % len(self.tests['fixes'])
             print "regressions: %d" % len(self.tests['regressions'])
+        if len(self.results) > 1:
+            tests, _ = self.compare_times()
+            print "  slowdowns: %d" % len([t for t in tests if t.significant])
 
         print "      total: %d" % sum(self.totals.values())
@@ -23,10 +23,12 @@
 
 from weakref import WeakKeyDictionary
 import multiprocessing
+import os
+import sys
+import traceback
 
-from threadpool import ThreadPool, WorkRequest
 from patterns import Singleton
-from threading import RLock
+from threading import RLock, Thread
 
 
 def synchronized_self(function):
@@ -48,13 +50,159 @@ synchronized_self.locks = WeakKeyDictionary()
 
 
 class ConcurrentTestPool(Singleton):
+    '''
+    Runs queued work in a bounded set of worker processes.
+
+    Work is queued with ``put`` and then handed out by ``start``, which
+    forks the workers.  The workers inherit the queued callables through
+    fork, so only the index of each item and its return value cross
+    process boundaries; the return value must therefore be picklable.
+    All workers pull from a single shared queue, so an idle worker always
+    takes the next pending item and no worker sits idle while work
+    remains.
+
+    Each item's ``callback`` is called in the parent process, from a
+    single collector thread, with the value the item returned.  If the
+    item raised instead, or the worker running it (or every worker,
+    before it was run) exited, its ``error_callback`` is called from the
+    same thread with a description of the error and whether the worker
+    crashed.  So every item gets exactly one of the two calls.
+    '''
     @synchronized_self
     def init(self):
-        self.pool = ThreadPool(multiprocessing.cpu_count())
+        self.__work = []
+        self.__workers = []
+        self.__collector = None
+        self.__processes = 1
+
+    @synchronized_self
+    def put(self, callable_, args=None, kwds=None, callback=None,
+            error_callback=None):
+        assert not self.__workers, \
+            'work must be queued before the pool is started'
+        self.__work.append((callable_, args or (), kwds or {}, callback,
+                            error_callback))
 
     @synchronized_self
-    def put(self, callable_, args=None, kwds=None):
-        self.pool.putRequest(WorkRequest(callable_, args=args, kwds=kwds))
+    def start(self, jobs=None):
+        '''
+        Fork ``jobs`` worker processes (one per cpu by default) and start
+        handing out the queued work.
+        '''
+        if not self.__work:
+            return
+        if jobs is None:
+            jobs = multiprocessing.cpu_count()
+        jobs = max(1, min(jobs, len(self.__work)))
+
+        self.__pending = multiprocessing.Queue()
+        # Workers report to the collector synchronously.  The feeder
+        # thread of a multiprocessing.Queue would lose everything a
+        # worker reported since its last flush if the worker died.
+        self.__done_reader, self.__done_writer = multiprocessing.Pipe(False)
+        self.__done_lock = multiprocessing.Lock()
+        for i in xrange(len(self.__work)):
+            self.__pending.put(i)
+        for i in xrange(jobs):
+            self.__pending.put(None)
+
+        # The workers, and the main process running the tests that
+        # aren't concurrent.
+        self.__processes = jobs + 1
+
+        # Anything left in the stdio buffers would be written once by
+        # every worker.
+        sys.stdout.flush()
+        sys.stderr.flush()
+
+        for i in xrange(jobs):
+            worker = multiprocessing.Process(target=self.__worker_main)
+            worker.daemon = True
+            worker.start()
+            self.__workers.append(worker)
+
+        self.__collector = Thread(target=self.__collect)
+        self.__collector.daemon = True
+        self.__collector.start()
+
+    # Messages from the workers to the collector
+    __STARTED, __DONE, __FAILED = range(3)
+
+    def __worker_main(self):
+        pid = os.getpid()
+        while True:
+            i = self.__pending.get()
+            if i is None:
+                break
+            self.__report((self.__STARTED, i, pid, None))
+            callable_, args, kwds = self.__work[i][:3]
+            try:
+                self.__report((self.__DONE, i, pid,
+                               callable_(*args, **kwds)))
+            except:
+                self.__report((self.__FAILED, i, pid,
+                               traceback.format_exc()))
+
+    def __report(self, message):
+        with self.__done_lock:
+            self.__done_writer.send(message)
+
+    def __fail(self, i, error, crashed):
+        error_callback = self.__work[i][4]
+        if error_callback is not None:
+            error_callback(error, crashed)
+        else:
+            sys.stderr.write(error)
+
+    def __collect(self):
+        remaining = set(xrange(len(self.__work)))
+        # Map from the pid of each worker to the item it is running
+        running = {}
+        while remaining:
+            if not self.__done_reader.poll(1):
+                for worker in self.__workers:
+                    if not worker.is_alive() and worker.pid in running:
+                        i = running.pop(worker.pid)
+                        remaining.discard(i)
+                        self.__fail(i, 'test worker exited with code {0} '
+                                    'while running this test\n'.format(
+                                        worker.exitcode), True)
+                # Don't wait forever if every worker died.
+                if not any(w.is_alive() for w in self.__workers):
+                    for i in sorted(remaining):
+                        self.__fail(i, 'all test workers exited before '
+                                    'running this test\n', True)
+                    return
+                continue
+
+            kind, i, pid, value = self.__done_reader.recv()
+            if kind == self.__STARTED:
+                running[pid] = i
+                continue
+            running.pop(pid, None)
+            remaining.discard(i)
+            if kind == self.__FAILED:
+                self.__fail(i, value, False)
+            elif self.__work[i][3] is not None:
+                self.__work[i][3](value)
+
+    def processes(self):
+        '''
+        Return the number of processes that may be running tests: the
+        workers of the started pool and the main process, or just the
+        main process if the pool isn't running.
+
+        Not synchronized, so that workers can call it.  start() holds
+        the pool's lock while it forks them.
+        '''
+        return self.__processes
 
     def join(self):
-        self.pool.wait()
+        '''
+        Wait for all of the queued work to finish and reset the pool.
+        '''
+        if self.__collector is not None:
+            self.__collector.join()
+        for worker in self.__workers:
+            worker.join()
+        self.init()
@@ -0,0 +1,224 @@
+# Copyright (c) 2013 The Piglit project
+#
+# Permission is hereby granted, free of charge, to any person
+# obtaining a copy of this software and associated documentation
+# files (the "Software"), to deal in the Software without
+# restriction, including without limitation the rights to use,
+# copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following
+# conditions:
+#
+# This permission notice shall be included in all copies or
+# substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+# KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+# WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+# PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHOR(S) BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+# AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+# OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+"""Compare how long tests took across a series of runs.
+
+Every result records the 'time' its test took.  The summary tools use
+this module to find the tests, and the groups of tests, that got slower
+in the last run of a series, compared to the runs before it.
+
+The time of a test in one run is a single, noisy sample.  A slowdown is
+only flagged as significant if the last time exceeds the mean of the
+earlier ones by at least SLOWDOWN_RATIO and MIN_SLOWDOWN seconds, and,
+when there are at least MIN_BASELINE_RUNS earlier runs to estimate the
+noise from, by SIGNIFICANCE standard deviations of them.
+
+Tests that ran in a process of their own also record the 'rusage' of
+that process.  resource_usage() adds it up for every group of tests.
+"""
+
+import math
+import os.path as path
+
+__all__ = ['ResourceUsage',
+           'TimingDelta',
+           'compare_times',
+           'resource_usage',
+           'result_time']
+
+SLOWDOWN_RATIO = 1.2
+MIN_SLOWDOWN = 0.05
+MIN_BASELINE_RUNS = 3
+SIGNIFICANCE = 3.0
+
+
+def result_time(result):
+    """Return the time a test result took in seconds, or None."""
+    if result is None:
+        return None
+    try:
+        return float(result['time'])
+    except (KeyError, TypeError, ValueError):
+        return None
+
+
+def _mean(values):
+    return sum(values) / len(values)
+
+
+def _stddev(values):
+    mean = _mean(values)
+    return math.sqrt(sum((v - mean) ** 2 for v in values) /
+                     (len(values) - 1))
+
+
+def _is_slowdown(baseline, latest):
+    mean = _mean(baseline)
+    if latest < mean * SLOWDOWN_RATIO or latest - mean < MIN_SLOWDOWN:
+        return False
+    if len(baseline) >= MIN_BASELINE_RUNS:
+        return latest - mean > SIGNIFICANCE * _stddev(baseline)
+    return True
+
+
+class TimingDelta(object):
+    """The times of a test, or of a group of tests, in a series of runs.
+
+    ``times`` holds the time of each run in seconds, None where it is
+    unknown.  The time of a group is the sum of the times of its tests.
+    ``baseline`` is the mean of the known times before the last one.
+    ``delta`` and ``ratio`` compare the last time to it, and are None if
+    either is unknown.
+    """
+
+    def __init__(self, name, times, group=False):
+        self.name = name
+        self.times = times
+        self.group = group
+        self.latest = times[-1]
+
+        baseline = [t for t in times[:-1] if t is not None]
+        self.baseline = _mean(baseline) if baseline else None
+
+        self.delta = None
+        self.ratio = None
+        self.significant = False
+        if self.latest is not None and self.baseline is not None:
+            self.delta = self.latest - self.baseline
+            if self.baseline > 0:
+                self.ratio = self.latest / self.baseline
+            self.significant = _is_slowdown(baseline, self.latest)
+
+    def sort_key(self):
+        """Key ordering the most regressed first, then the slowest."""
+        return (not self.significant,
+                -(self.delta or 0.0),
+                -(self.latest or 0.0),
+                self.name)
+
+
+def compare_times(runs):
+    """Compare the times of the tests in a series of runs.
+
+    ``runs`` is a list of dicts mapping test names to results, the
+    ``tests`` of each TestrunResult, oldest first.
+
+    :return: ``(tests, groups)``, lists of TimingDelta for every test and
+             every group, sorted by TimingDelta.sort_key().  A group only
+             adds up the tests that have a time in every run, so that its
+             totals compare the same tests.
+    """
+    names = set()
+    for run in runs:
+        names.update(run)
+
+    tests = []
+    group_times = {}
+    for name in names:
+        times = [result_time(run.get(name)) for run in runs]
+        tests.append(TimingDelta(name, times))
+
+        if None in times:
+            continue
+        group = path.dirname(name)
+        while group:
+            totals = group_times.setdefault(group, [0.0] * len(runs))
+            for i, t in enumerate(times):
+                totals[i] += t
+            group = path.dirname(group)
+
+    groups = [TimingDelta(name, times, group=True)
+              for name, times in group_times.iteritems()]
+
+    tests.sort(key=TimingDelta.sort_key)
+    groups.sort(key=TimingDelta.sort_key)
+    return tests, groups
+
+
+class ResourceUsage(object):
+    """The resources a test, or a group of tests, used in one run.
+
+    The attributes are those of the 'rusage' of a result, see
+    exectest._rusage_dict, plus ``time``, the wall time in seconds, and
+    ``tests``, the number of results added up.  Everything is summed over
+    the tests of a group, except ``maxrss``, which is the largest of
+    them.
+    """
+
+    SUMS = ('utime', 'stime', 'minflt', 'majflt', 'nvcsw', 'nivcsw')
+
+    def __init__(self, name, group=False):
+        self.name = name
+        self.group = group
+        self.tests = 0
+        self.time = 0.0
+        self.maxrss = 0
+        for key in self.SUMS:
+            setattr(self, key, 0)
+
+    @property
+    def cpu(self):
+        return self.utime + self.stime
+
+    def add(self, result):
+        rusage = result['rusage']
+        self.tests += 1
+        self.time += result_time(result) or 0.0
+        self.maxrss = max(self.maxrss, rusage['maxrss'])
+        for key in self.SUMS:
+            setattr(self, key, getattr(self, key) + rusage[key])
+
+    def sort_key(self):
+        """Key ordering the largest CPU time first."""
+        return (-self.cpu, -self.maxrss, self.name)
+
+
+def resource_usage(run):
+    """Add up the resources the tests of a run used.
+
+    ``run`` maps test names to results, as the ``tests`` of a
+    TestrunResult.  Results without 'rusage', such as those of tests that
+    ran in a batch worker, are left out.
+
+    :return: ``(tests, groups)``, lists of ResourceUsage sorted by
+             ResourceUsage.sort_key().
+    """
+    tests = []
+    groups = {}
+    for name, result in run.iteritems():
+        if 'rusage' not in result:
+            continue
+        usage = ResourceUsage(name)
+        usage.add(result)
+        tests.append(usage)
+
+        group = path.dirname(name)
+        while group:
+            if group not in groups:
+                groups[group] = ResourceUsage(group, group=True)
+            groups[group].add(result)
+            group = path.dirname(group)
+
+    tests.sort(key=ResourceUsage.sort_key)
+    groups = sorted(groups.values(), key=ResourceUsage.sort_key)
+    return tests, groups
@@ -130,6 +130,12 @@ class GlslBuiltinType(object):
     def __repr__(self):
         return 'glsl_{0}'.format(self.__name)
 
+    def __reduce__(self):
+        # Types are compared by identity, so unpickling (e.g. in the
+        # worker processes of generate_in_parallel()) must yield the
+        # module level instance rather than a copy.
+        return 'glsl_{0}'.format(self.__name)
+
 
 # Concrete declarations of GlslBuiltinType
 glsl_bool   = GlslBuiltinType('bool',   None,       1, 1, 110)
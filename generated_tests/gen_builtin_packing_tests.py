@@ -7,6 +7,7 @@ import math
 import numpy as np
 import optparse
 import os
+import StringIO
 import sys
 
 from collections import namedtuple
@@ -15,6 +16,8 @@ from math import copysign, fabs, fmod, frexp, isinf, isnan, modf
 from numpy import int8, int16, int32, uint8, uint16, uint32, float32
 from textwrap import dedent
 
+from generated_files import write_file
+
 # ----------------------------------------------------------------------------
 # Overview
 # ----------------------------------------------------------------------------
@@ -1400,13 +1403,10 @@ class ShaderTest:
         return self.__filename
 
     def write_file(self):
-        dirname = os.path.dirname(self.filename)
-        if not os.path.exists(dirname):
-            os.makedirs(dirname)
-
-        with open(self.filename, "w") as buffer:
-            ctx = mako.runtime.Context(buffer, func=self.__func_info)
-            self.__template.render_context(ctx)
+        buffer = StringIO.StringIO()
+        ctx = mako.runtime.Context(buffer, func=self.__func_info)
+        self.__template.render_context(ctx)
+        write_file(self.filename, buffer.getvalue())
 
 
 def main():
@@ -45,6 +45,7 @@
 # of the files; it doesn't generate them.
 
 from builtin_function import *
+from generated_files import write_file, generate_in_parallel
 import abc
 import numpy
 import optparse
@@ -499,12 +500,7 @@ class ShaderTest(object):
         shader_test += self.make_vbo_data()
         shader_test += '[test]\n'
         shader_test += self.make_test()
-        filename = self.filename()
-        dirname = os.path.dirname(filename)
-        if not os.path.exists(dirname):
-            os.makedirs(dirname)
-        with open(filename, 'w') as f:
-            f.write(shader_test)
+        write_file(self.filename(), shader_test)
 
 
 class VertexShaderTest(ShaderTest):
@@ -624,6 +620,11 @@ def all_tests():
             yield FragmentShaderTest(signature, test_vectors, use_if)
 
 
+def generate_shader_test(test):
+    test.generate_shader_test()
+    return test.filename()
+
+
 def main():
     desc = 'Generate shader tests that test built-in functions using uniforms'
     usage = 'usage: %prog [-h] [--names-only]'
@@ -634,10 +635,12 @@ def main():
         action='store_true',
         help="Don't output files, just generate a list of filenames to stdout")
     options, args = parser.parse_args()
-    for test in all_tests():
-        if not options.names_only:
-            test.generate_shader_test()
-        print test.filename()
+    if options.names_only:
+        filenames = [test.filename() for test in all_tests()]
+    else:
+        filenames = generate_in_parallel(generate_shader_test, all_tests())
+    for filename in filenames:
+        print filename
 
 
 if __name__ == '__main__':
@@ -35,6 +35,7 @@
 # of the files; it doesn't generate them.
 
 from builtin_function import *
+from generated_files import write_file, generate_in_parallel
 import abc
 import optparse
 import os
@@ -191,12 +192,7 @@ class ParserTest(object):
                 glsl_constant(test_vector.result))
         parser_test += ' */\n'
         parser_test += self.make_shader()
-        filename = self.filename()
-        dirname = os.path.dirname(filename)
-        if not os.path.exists(dirname):
-            os.makedirs(dirname)
-        with open(filename, 'w') as f:
-            f.write(parser_test)
+        write_file(self.filename(), parser_test)
 
 
 class VertexParserTest(ParserTest):
@@ -242,6 +238,11 @@ def all_tests():
         yield FragmentParserTest(signature, test_vectors)
 
 
+def generate_parser_test(test):
+    test.generate_parser_test()
+    return test.filename()
+
+
 def main():
     desc = 'Generate shader tests that test built-in functions using constant'\
            'array sizes'
@@ -254,10 +255,12 @@ def main():
                            "filenames to stdout")
     options, args = parser.parse_args()
 
-    for test in all_tests():
-        if not options.names_only:
-            test.generate_parser_test()
-        print test.filename()
+    if options.names_only:
+        filenames = [test.filename() for test in all_tests()]
+    else:
+        filenames = generate_in_parallel(generate_parser_test, all_tests())
+    for filename in filenames:
+        print filename
 
 
 if __name__ == '__main__':
@@ -65,6 +65,8 @@
 
 import os
 
+from generated_files import write_file
+
 
 class Test(object):
     def __init__(self, interpolation_qualifier, variable, shade_model,
@@ -322,12 +324,7 @@ class Test(object):
         for x, y, r, g, b, a in self.probe_data():
             test += ('relative probe rgba ({0}, {1}) ({2}, {3}, {4}, {5})\n'
                      .format(x, y, r, g, b, a))
-        filename = self.filename()
-        dirname = os.path.dirname(filename)
-        if not os.path.exists(dirname):
-            os.makedirs(dirname)
-        with open(filename, 'w') as f:
-            f.write(test)
+        write_file(self.filename(), test)
 
 
 def all_tests():
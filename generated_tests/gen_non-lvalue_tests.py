@@ -23,6 +23,8 @@
 
 import os
 
+from generated_files import write_file
+
 
 class Test(object):
     def __init__(self, type_name, op, usage, shader_target):
@@ -137,12 +139,7 @@ void main()
                            var_as_vec4=var_as_vec4,
                            mode=mode)
 
-        filename = self.filename()
-        dirname = os.path.dirname(filename)
-        if not os.path.exists(dirname):
-            os.makedirs(dirname)
-        with open(filename, 'w') as f:
-            f.write(test)
+        write_file(self.filename(), test)
 
 
 def all_tests():
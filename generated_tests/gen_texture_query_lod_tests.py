@@ -27,6 +27,8 @@ import os.path
 from mako.template import Template
 from textwrap import dedent
 
+from generated_files import write_file
+
 sampler_type_to_coord_type = {
     'sampler1D':              'float',
     'isampler1D':             'float',
@@ -126,10 +128,6 @@ for api, requirement in requirements.iteritems():
                                                                      file_extension))
             print filename
 
-            dirname = os.path.dirname(filename)
-            if not os.path.exists(dirname):
-                os.makedirs(dirname)
-
             version = requirement['version']
             extensions = [requirement['extension']] if requirement['extension'] else []
 
@@ -140,11 +138,10 @@ for api, requirement in requirements.iteritems():
                     'usamplerCubeArray', 'samplerCubeArrayShadow']:
                 extensions += ['GL_ARB_texture_cube_map_array']
 
-            f = open(filename, "w")
-            f.write(template.render(version=version,
-                                    extensions=extensions,
-                                    execution_stage=execution_stage,
-                                    sampler_type=sampler_type,
-                                    coord_type=coord_type,
-                                    Lod=Lod))
-            f.close()
+            write_file(filename,
+                       template.render(version=version,
+                                       extensions=extensions,
+                                       execution_stage=execution_stage,
+                                       sampler_type=sampler_type,
+                                       coord_type=coord_type,
+                                       Lod=Lod))
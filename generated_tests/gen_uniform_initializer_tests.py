@@ -25,6 +25,8 @@ import os
 import os.path
 from mako.template import Template
 
+from generated_files import write_file
+
 
 def open_src_file(filename):
     """Open a file relative to the source directory"""
@@ -69,10 +71,6 @@ def generate_tests(type_list, base_name, major, minor):
                 '{0}-{1}{2}.shader_test'.format(target, base_name, t))
             print test_file_name
 
-            dirname = os.path.dirname(test_file_name)
-            if not os.path.exists(dirname):
-                os.makedirs(dirname)
-
             # Generate the test vectors.  This is a list of tuples.  Each
             # tuple is a type name paired with a value.  The value is
             # formatted as a GLSL constructor.
@@ -106,12 +104,11 @@ def generate_tests(type_list, base_name, major, minor):
                 api_vectors.append((api_type, name, alt_numbers))
                 j = j + 1
 
-            f = open(test_file_name, "w")
-            f.write(Template(template).render(type_list=test_vectors,
-                                              api_types=api_vectors,
-                                              major=major,
-                                              minor=minor))
-            f.close()
+            write_file(test_file_name,
+                       Template(template).render(type_list=test_vectors,
+                                                 api_types=api_vectors,
+                                                 major=major,
+                                                 minor=minor))
 
 
 def generate_array_tests(type_list, base_name, major, minor):
@@ -130,10 +127,6 @@ def generate_array_tests(type_list, base_name, major, minor):
             '{0}-{1}-array.shader_test'.format(target, base_name))
         print test_file_name
 
-        dirname = os.path.dirname(test_file_name)
-        if not os.path.exists(dirname):
-            os.makedirs(dirname)
-
         test_vectors = []
         j = 0
         for (type, num_values) in type_list:
@@ -157,11 +150,10 @@ def generate_array_tests(type_list, base_name, major, minor):
             test_vectors.append((array_type, name, value))
             j = j + 1
 
-        f = open(test_file_name, "w")
-        f.write(Template(template).render(type_list=test_vectors,
-                                          major=major,
-                                          minor=minor))
-        f.close()
+        write_file(test_file_name,
+                   Template(template).render(type_list=test_vectors,
+                                             major=major,
+                                             minor=minor))
 
 # These are a set of pseudo random values used by the number sequence
 # generator.  See get_value above.
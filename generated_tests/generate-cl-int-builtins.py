@@ -1,6 +1,9 @@
 # !/usr/bin/env python
 
 import os
+import StringIO
+
+from generated_files import write_file, generate_in_parallel
 
 # Builtins is a data structure of the following:
 #  builtins = {
@@ -850,85 +853,99 @@ def generate_kernels(f, dataType, fnName, fnDef):
         gen_kernel_1_arg(f, fnName, argTypes[1], argTypes[0])
         return
 
-    if (len(argTypes) == 3 and not fnName is 'upsample'):
+    if (len(argTypes) == 3 and fnName != 'upsample'):
         gen_kernel_2_arg_same_type(f, fnName, argTypes[1], argTypes[0])
-        if (fnDef['function_type'] is 'tss'):
+        if (fnDef['function_type'] == 'tss'):
             gen_kernel_2_arg_mixed_size(f, fnName, argTypes[1], argTypes[0])
         return
 
     if (len(argTypes) == 4):
         gen_kernel_3_arg_same_type(f, fnName, argTypes[1], argTypes[0])
-        if (fnDef['function_type'] is 'tss'):
+        if (fnDef['function_type'] == 'tss'):
             gen_kernel_3_arg_mixed_size(f, fnName, argTypes[1], argTypes[0])
         return
 
-    if (fnName is 'upsample'):
+    if (fnName == 'upsample'):
         gen_kernel_2_arg_mixed_sign(f, fnName, argTypes[1], argTypes[2],
                                     argTypes[0])
         return
 
 
-def main():
-    # Create the output directory if required
-    dirName = os.path.join("cl", "builtin", "int")
-    if not os.path.exists(dirName):
-        os.makedirs(dirName)
+def all_files():
+    """Return the (dataType, fnName) pairs to generate a file for."""
+    files = []
 
     # Loop over all data types being tested. Create one output file per data
     # type
     for dataType in DATA_TYPES:
         functions = getFnNames()  # List of all built-in functions
         for fnName in functions:
-            if (fnName is 'upsample' and
-                    (dataType is 'long' or dataType is 'ulong')):
+            if (fnName == 'upsample' and
+                    (dataType == 'long' or dataType == 'ulong')):
                 continue
-            # Merge all of the generic/signed/unsigned/custom test definitions
-            functionDef = mergedTestDefinition(dataType, fnName)
 
             # Check if the function actually exists for this data type
-            if (not functionDef.keys()):
+            if (not mergedTestDefinition(dataType, fnName).keys()):
                 continue
 
-            clcVersionMin = CLC_VERSION_MIN[fnName]
+            files.append((dataType, fnName))
 
-            fileName = 'builtin-' + dataType + '-' + fnName + '-' + \
-                str(float(clcVersionMin)/10)+'.generated.cl'
+    return files
 
-            fileName = os.path.join(dirName, fileName)
 
-            f = open(fileName, 'w')
-            print(fileName)
-            # Write the file header
-            f.write('/*!\n' +
-                    '[config]\n' +
-                    'name: Test '+dataType+' '+fnName+' built-in on CL 1.1\n' +
-                    'clc_version_min: '+str(clcVersionMin)+'\n' +
-                    'dimensions: 1\n' +
-                    'global_size: 1 0 0\n\n'
-            )
+def generate_file(dataType_fnName):
+    dataType, fnName = dataType_fnName
+
+    # Merge all of the generic/signed/unsigned/custom test definitions
+    functionDef = mergedTestDefinition(dataType, fnName)
 
-            # Write all tests for the built-in function
-            tests = functionDef['values']
-            argCount = len(functionDef['arg_types'])
-            fnType = functionDef['function_type']
+    clcVersionMin = CLC_VERSION_MIN[fnName]
 
-            outputValues = tests[0]
-            numTests = len(outputValues)
+    fileName = 'builtin-' + dataType + '-' + fnName + '-' + \
+        str(float(clcVersionMin)/10)+'.generated.cl'
+
+    fileName = os.path.join("cl", "builtin", "int", fileName)
+
+    f = StringIO.StringIO()
+    # Write the file header
+    f.write('/*!\n' +
+            '[config]\n' +
+            'name: Test '+dataType+' '+fnName+' built-in on CL 1.1\n' +
+            'clc_version_min: '+str(clcVersionMin)+'\n' +
+            'dimensions: 1\n' +
+            'global_size: 1 0 0\n\n'
+    )
 
-            # Handle all available scalar/vector widths
-            sizes = sorted(VEC_WIDTHS)
-            sizes.insert(0, 1)  # Add 1-wide scalar to the vector widths
-            for vecSize in sizes:
-                for testIdx in range(0, numTests):
-                    print_test(f, fnName, dataType, functionDef, tests,
-                               testIdx, vecSize, (fnType is 'tss'))
+    # Write all tests for the built-in function
+    tests = functionDef['values']
+    argCount = len(functionDef['arg_types'])
+    fnType = functionDef['function_type']
 
-            # Terminate the header section
-            f.write('!*/\n\n')
+    outputValues = tests[0]
+    numTests = len(outputValues)
 
-            # Generate the actual kernels
-            generate_kernels(f, dataType, fnName, functionDef)
+    # Handle all available scalar/vector widths
+    sizes = sorted(VEC_WIDTHS)
+    sizes.insert(0, 1)  # Add 1-wide scalar to the vector widths
+    for vecSize in sizes:
+        for testIdx in range(0, numTests):
+            print_test(f, fnName, dataType, functionDef, tests,
+                       testIdx, vecSize, (fnType == 'tss'))
+
+    # Terminate the header section
+    f.write('!*/\n\n')
+
+    # Generate the actual kernels
+    generate_kernels(f, dataType, fnName, functionDef)
+
+    write_file(fileName, f.getvalue())
+    return fileName
+
+
+def main():
+    for fileName in generate_in_parallel(generate_file, all_files()):
+        print(fileName)
 
-        f.close()
 
-main()
+if __name__ == '__main__':
+    main()
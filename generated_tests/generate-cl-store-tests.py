@@ -26,8 +26,11 @@
 #
 
 import os
+import StringIO
 import textwrap
 
+from generated_files import write_file
+
 TYPES = ['char', 'uchar', 'short', 'ushort', 'int', 'uint', 'long', 'ulong', 'float', 'double']
 VEC_SIZES = ['', '2', '4', '8', '16']
 
@@ -50,14 +53,21 @@ def print_config(f, type_name, addr_space):
     """.format(type_name=type_name, addr_space=addr_space)))
 
 
+def test_file_name(type_name, addr_space):
+    return os.path.join(dirName, 'store-' + type_name + '-' + addr_space + '.program_test')
+
+
 def begin_test(type_name, addr_space):
-    fileName = os.path.join(dirName, 'store-' + type_name + '-' + addr_space + '.program_test')
-    print(fileName)
-    f = open(fileName, 'w')
+    print(test_file_name(type_name, addr_space))
+    f = StringIO.StringIO()
     print_config(f, type_name, addr_space)
     return f
 
 
+def end_test(f, type_name, addr_space):
+    write_file(test_file_name(type_name, addr_space), f.getvalue())
+
+
 for t in TYPES:
     for s in VEC_SIZES:
         if s == '':
@@ -81,7 +91,7 @@ for t in TYPES:
         arg_in:  1 buffer {type_name}[8] {gen_array}
         """.format(type_name=type_name, gen_array=gen_array(size))))
 
-        f.close()
+        end_test(f, type_name, 'global')
 
         f = begin_test(type_name, 'local')
         f.write(textwrap.dedent("""
@@ -94,4 +104,4 @@ for t in TYPES:
         arg_in:  1 buffer {type_name}[8] {gen_array}
         """.format(type_name=type_name, gen_array=gen_array(size))))
 
-        f.close()
+        end_test(f, type_name, 'local')
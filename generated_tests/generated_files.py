@@ -0,0 +1,89 @@
+# coding=utf-8
+#
+# Copyright © 2013 The Piglit project
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+# Helpers shared by the test generators.
+#
+# The build reruns a generator whenever the generator or one of its
+# inputs changes, and each run used to rewrite every file it generates.
+# write_file() leaves a file untouched if it already has the content
+# being written, so the mtimes of tests that didn't change stay stable,
+# and neither piglit's metadata index nor anything else keyed on them is
+# invalidated.
+#
+# generate_in_parallel() spreads the generation of many files over
+# worker processes.
+
+import errno
+import multiprocessing
+import os
+
+
+def write_file(filename, contents):
+    """Write contents to filename, unless the file already holds them.
+
+    Missing directories are created.  Returns True if the file was
+    written.
+    """
+    try:
+        with open(filename, 'r') as f:
+            if f.read() == contents:
+                return False
+    except IOError as e:
+        if e.errno != errno.ENOENT:
+            raise
+
+    dirname = os.path.dirname(filename)
+    if dirname and not os.path.isdir(dirname):
+        try:
+            os.makedirs(dirname)
+        except OSError as e:
+            # Another worker may have created it meanwhile.
+            if e.errno != errno.EEXIST:
+                raise
+
+    with open(filename, 'w') as f:
+        f.write(contents)
+    return True
+
+
+def generate_in_parallel(function, items, chunksize=16):
+    """Return [function(item) for item in items], computed in parallel.
+
+    function must be defined at module level, and the items and results
+    must be picklable, since they are sent to and from worker processes.
+    Scripts using this must only run their main() under
+    "if __name__ == '__main__'", because worker processes may import them.
+    """
+    try:
+        processes = multiprocessing.cpu_count()
+    except NotImplementedError:
+        processes = 1
+    if processes == 1:
+        return map(function, items)
+
+    pool = multiprocessing.Pool(processes)
+    try:
+        return pool.map(function, items, chunksize)
+    finally:
+        pool.close()
+        pool.join()
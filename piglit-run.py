@@ -32,6 +32,10 @@ import json
 
 sys.path.append(path.dirname(path.realpath(sys.argv[0])))
 import framework.core as core
+import framework.gleantest
+import framework.glsl_parser_test
+import framework.metadata
+import framework.shader_test
 from framework.threads import synchronized_self
 
 
@@ -84,12 +88,62 @@ def main():
                            metavar="<boolean>",
                            choices=["1", "0", "on", "off"],
                            help="Deprecated: Turn concrrent runs on or off")
+    parser.add_argument("-j", "--jobs",
+                        type=int,
+                        default=None,
+                        metavar="<n>",
+                        help="Number of worker processes for concurrent "
+                             "tests (default: number of cpus)")
+    parser.add_argument("--streaming",
+                        action="store_true",
+                        help="Write results in the streaming, line-delimited "
+                             "format, which can be resumed without rewriting "
+                             "it")
+    parser.add_argument("--timings",
+                        metavar="<results path>",
+                        default=None,
+                        help="Results of an earlier run, used to start the "
+                             "longest tests first")
     parser.add_argument("-p", "--platform",
                         choices=["glx", "x11_egl", "wayland", "gbm"],
                         help="Name of windows system passed to waffle")
     parser.add_argument("--valgrind",
                         action="store_true",
                         help="Run tests in valgrind's memcheck")
+    parser.add_argument("--shader-runner-batch",
+                        action="store_true",
+                        help="Run shader tests in a pool of long-lived "
+                             "shader_runner processes")
+    parser.add_argument("--shader-runner-bench",
+                        type=int,
+                        default=0,
+                        metavar="<iterations>",
+                        help="Time <iterations> runs of each shader test "
+                             "after it passes, and record the CPU and GPU "
+                             "times in the results")
+    parser.add_argument("--glslparsertest-batch",
+                        action="store_true",
+                        help="Run GLSL parser tests in a pool of long-lived "
+                             "glslparsertest processes")
+    parser.add_argument("--glean-batch",
+                        action="store_true",
+                        help="Run glean tests in a pool of long-lived glean "
+                             "processes")
+    parser.add_argument("--prefilter",
+                        action="store_true",
+                        help="Probe each context the shader and GLSL parser "
+                             "tests need once, and skip tests whose "
+                             "requirements it can't meet without running "
+                             "them")
+    parser.add_argument("--metadata-index",
+                        metavar="<file>",
+                        default=framework.metadata.default_index_path(),
+                        help="Cache the metadata parsed from test files in "
+                             "<file>, so later runs can skip reading "
+                             "unchanged files (default: %(default)s)")
+    parser.add_argument("--no-metadata-index",
+                        action="store_true",
+                        help="Don't read or write the metadata index")
     parser.add_argument("testProfile",
                         metavar="<Path to test profile>",
                         help="Path to testfile to run")
@@ -128,17 +182,30 @@ def main():
     # Always Convert Results Path from Relative path to Actual Path.
     resultsDir = path.realpath(args.resultsPath)
 
+    result_filepath = os.path.join(resultsDir, 'main')
+
     # If resume is requested attempt to load the results file
     # in the specified path
     if args.resume is True:
-        # Load settings from the old results JSON
-        old_results = core.loadTestResults(resultsDir)
-        profileFilename = old_results.options['profile']
+        with open(result_filepath, 'r') as f:
+            args.streaming = core.StreamingResultsWriter.is_streaming(f)
+
+        # Load settings from the old results.  A streaming results file
+        # is appended to in place, so only the names of the completed
+        # tests are needed.
+        if args.streaming:
+            old_header, old_tests = \
+                core.StreamingResultsWriter.resume(result_filepath)
+            old_options = old_header['options']
+        else:
+            old_results = core.loadTestResults(resultsDir)
+            old_options = old_results.options
+        profileFilename = old_options['profile']
 
         # Changing the args to the old args allows us to set them
         # all in one places down the way
-        args.exclude_tests = old_results.options['exclude_filter']
-        args.include_tests = old_results.options['filter']
+        args.exclude_tests = old_options['exclude_filter']
+        args.include_tests = old_options['filter']
 
     # Otherwise parse additional settings from the command line
     else:
@@ -149,7 +216,26 @@ def main():
                            exclude_filter=args.exclude_tests,
                            include_filter=args.include_tests,
                            execute=args.execute,
-                           valgrind=args.valgrind)
+                           valgrind=args.valgrind,
+                           jobs=args.jobs)
+
+    if args.timings is not None:
+        env.timings = core.loadTestTimes(args.timings)
+
+    framework.shader_test.ShaderTest.batch_mode = args.shader_runner_batch
+    framework.shader_test.ShaderTest.bench_iterations = \
+        args.shader_runner_bench
+    framework.glsl_parser_test.GLSLParserTest.batch_mode = \
+        args.glslparsertest_batch
+
+    framework.gleantest.GleanTest.batch_mode = args.glean_batch
+
+    framework.shader_test.ShaderTest.prefilter_requirements = args.prefilter
+    framework.glsl_parser_test.GLSLParserTest.prefilter_requirements = \
+        args.prefilter
+
+    if not args.no_metadata_index:
+        framework.metadata.open_index(path.realpath(args.metadata_index))
 
     # Change working directory to the root of the piglit directory
     piglit_dir = path.dirname(path.realpath(sys.argv[0]))
@@ -165,8 +251,12 @@ def main():
     else:
         results.name = path.basename(resultsDir)
 
+    if args.streaming:
+        run_streaming(args, env, results, profileFilename, result_filepath,
+                      old_tests if args.resume else None)
+        return
+
     # Begin json.
-    result_filepath = os.path.join(resultsDir, 'main')
     result_file = open(result_filepath, 'w')
     json_writer = core.JSONWriter(result_file)
     json_writer.open_dict()
@@ -217,5 +307,40 @@ def main():
     print 'Results have been written to ' + result_filepath
 
 
+def run_streaming(args, env, results, profileFilename, result_filepath,
+                  completed_tests):
+    """
+    Run the profile, writing results in the streaming format.
+
+    If ``completed_tests`` is not None, the run is being resumed: results
+    are appended to the existing file, and the tests it names are skipped.
+    """
+    if completed_tests is None:
+        header = {'options': {'profile': profileFilename,
+                              'filter': args.include_tests,
+                              'exclude_filter': args.exclude_tests},
+                  'name': results.name}
+        header.update(env.collectData())
+        writer = core.StreamingResultsWriter(result_filepath, header)
+    else:
+        writer = core.StreamingResultsWriter(result_filepath)
+        for key in completed_tests:
+            if os.path.sep != '/':
+                key = key.replace(os.path.sep, '/', -1)
+            env.exclude_tests.add(key)
+
+    profile = core.loadTestProfile(profileFilename)
+
+    time_start = time.time()
+    profile.run(env, writer)
+    time_end = time.time()
+
+    writer.close(time_end - time_start)
+
+    print
+    print 'Thank you for running Piglit!'
+    print 'Results have been written to ' + result_filepath
+
+
 if __name__ == "__main__":
     main()
@@ -62,6 +62,24 @@ def main():
                              "given as arguments. This speeds up HTML "
                              "generation, but reduces the info in the HTML "
                              "pages. May be used multiple times")
+    parser.add_argument("-j", "--jobs",
+                        type=int,
+                        default=None,
+                        help="Number of processes used to render the test "
+                             "pages. Defaults to the number of CPUs")
+    parser.add_argument("-c", "--cache",
+                        default=".summarycache",
+                        metavar="<Cache Directory>",
+                        help="Directory used to cache rendered test pages "
+                             "between runs. Pages of tests whose results "
+                             "have not changed are reused from the cache, "
+                             "which keeps at most twice the pages of the "
+                             "last summary. Default: .summarycache")
+    parser.add_argument("--no-cache",
+                        dest="cache",
+                        action="store_const",
+                        const=None,
+                        help="Don't read or write the test page cache")
     parser.add_argument("summaryDir",
                         metavar="<Summary Directory>",
                         help="Directory to put HTML files in")
@@ -92,7 +110,8 @@ def main():
 
     # Create the HTML output
     output = summary.Summary(args.resultsFiles)
-    output.generateHTML(args.summaryDir, args.exclude_details)
+    output.generateHTML(args.summaryDir, args.exclude_details, args.jobs,
+                        args.cache)
 
 
 if __name__ == "__main__":
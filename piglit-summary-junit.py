@@ -31,6 +31,7 @@ import sys
 sys.path.append(os.path.dirname(os.path.realpath(sys.argv[0])))
 import framework.core as core
 from framework import junit
+from framework import timing
 
 
 class PassVector:
@@ -265,11 +266,17 @@ class Writer:
     def __init__(self, filename):
         self.report = junit.Report(filename)
         self.path = []
+        self.timings = {}
 
-    def write(self, arg):
+    def write(self, arg, baselines=()):
         results = [core.loadTestResults(arg)]
         summary = Summary(results)
 
+        # Compare the times of the tests to those in earlier runs
+        runs = [core.loadTestResults(b).tests for b in baselines]
+        tests, _ = timing.compare_times(runs + [results[0].tests])
+        self.timings = dict((t.name, t) for t in tests)
+
         self.report.start()
         self.report.startSuite('piglit')
         try:
@@ -314,9 +321,35 @@ class Writer:
                 duration = float(result['time'])
             except KeyError:
                 pass
+
+            self.write_measurements(test, result)
         finally:
             self.report.stopCase(duration)
 
+    def write_measurements(self, test, result):
+        delta = self.timings.get(test.path)
+        if delta is not None:
+            self.report.addMeasurement('time', delta.latest)
+            self.report.addMeasurement('time delta', delta.delta)
+            self.report.addMeasurement('time ratio', delta.ratio)
+            if delta.significant:
+                self.report.addStdout('Slowdown: %.3fs, %.2f times the '
+                                      'mean of the baseline runs\n' %
+                                      (delta.delta, delta.ratio or 0))
+
+        rusage = result.get('rusage')
+        if rusage is not None:
+            self.report.addMeasurement('cpu time',
+                                       rusage['utime'] + rusage['stime'])
+            self.report.addMeasurement('peak rss', rusage['maxrss'])
+
+        # Benchmark results, e.g. from shader_runner -bench, in ns
+        for name, stats in sorted(result.get('measurements', {}).items()):
+            for stat in ('min', 'median', 'p95'):
+                if stat in stats:
+                    self.report.addMeasurement('%s %s' % (name, stat),
+                                               stats[stat])
+
     def enter_path(self, path):
         ancestor = 0
         try:
@@ -342,6 +375,14 @@ def main():
 						dest    = "output",
 						default = "piglit.xml",
 						help    = "Output filename")
+    parser.add_argument("-b", "--baseline",
+						metavar = "<Baseline File>",
+						action  = "append",
+						dest    = "baselines",
+						default = [],
+						help    = "Results of an earlier run, whose test "
+						          "times are compared to the converted "
+						          "ones. May be given several times")
     parser.add_argument("testResults",
 						metavar = "<Input Files>",
 						help    = "JSON results file to be converted")
@@ -349,7 +390,7 @@ def main():
 
 
     writer = Writer(args.output)
-    writer.write(args.testResults)
+    writer.write(args.testResults, args.baselines)
 
 
 if __name__ == "__main__":
@@ -28,6 +28,10 @@
         <td>Time</td>
         <td>${time}</b>
       </tr>
+      <tr>
+        <td>Resource usage</td>
+        <td>${rusage}</td>
+      </tr>
       <tr>
         <td>Info</td>
         <td>
@@ -0,0 +1,132 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<!DOCTYPE html PUBLIC "-//W3C//DTD XHTML 1.0 Strict//EN"
+ "http://www.w3.org/TR/xhtml1/DTD/xhtml1-strict.dtd">
+<html xmlns="http://www.w3.org/1999/xhtml">
+  <head>
+    <meta http-equiv="Content-Type" content="text/html; charset=UTF-8" />
+    <title>Result summary</title>
+    <link rel="stylesheet" href="index.css" type="text/css" />
+    <script type="text/javascript">
+    //<![CDATA[
+    // Sort the rows of a timing table by the clicked column.  Names sort
+    // ascending, times descending, and unknown times ("-") last.
+    function sortTable(header, column, numeric) {
+      var table = header.parentNode.parentNode.parentNode;
+      var body = table.tBodies[0];
+      var rows = Array.prototype.slice.call(body.rows);
+      var value = function(row) {
+        var text = row.cells[column].textContent;
+        if (!numeric)
+          return text;
+        return text == "-" ? -Infinity : parseFloat(text);
+      };
+      rows.sort(function(a, b) {
+        var x = value(a), y = value(b);
+        if (numeric)
+          return y - x;
+        return x < y ? -1 : x > y;
+      });
+      for (var i = 0; i < rows.length; i++)
+        body.appendChild(rows[i]);
+    }
+    //]]>
+    </script>
+  </head>
+  <body>
+    <h1>Result summary</h1>
+    <p>Currently showing: timing</p>
+    <p>Show:
+      <a href="index.html">all</a>
+      % for i in pages:
+        % if i == 'timing':
+          | ${i}
+        % else:
+          | <a href="${i}.html">${i}</a>
+        % endif
+      % endfor
+    </p>
+    <p>
+      Times in seconds.
+      % if len(names) > 1:
+      The last run is compared to the mean of the earlier ones, and
+      significant slowdowns are highlighted.  Groups add up the tests that
+      ran in every run.
+      % endif
+      Click a column header to sort by it.
+    </p>
+    % for title, deltas in (('Groups', groups), ('Tests', tests)):
+    <h2>${title}</h2>
+    <table class="timing">
+      <thead>
+        <tr>
+          <th class="head" onclick="sortTable(this, 0, false)">Name</th>
+          % for i, name in enumerate(names):
+          <th class="head" onclick="sortTable(this, ${i + 1}, true)">${name | h}</th>
+          % endfor
+          % if len(names) > 1:
+          <th class="head" onclick="sortTable(this, ${len(names) + 1}, true)">Delta</th>
+          <th class="head" onclick="sortTable(this, ${len(names) + 2}, true)">Ratio</th>
+          % endif
+        </tr>
+      </thead>
+      <tbody>
+        % for delta in deltas:
+        <tr${' class="slowdown"' if delta.significant else ''}>
+          <td><div>${delta.name | h}</div></td>
+          % for time in delta.times:
+          <td>${'-' if time is None else '%.3f' % time}</td>
+          % endfor
+          % if len(names) > 1:
+          <td>${'-' if delta.delta is None else '%+.3f' % delta.delta}</td>
+          <td>${'-' if delta.ratio is None else '%.2f' % delta.ratio}</td>
+          % endif
+        </tr>
+        % endfor
+      </tbody>
+    </table>
+    % endfor
+    % if usage_groups:
+    <h2>Resource usage in ${names[-1] | h}</h2>
+    <p>
+      Tests that ran in a process of their own.  CPU times in seconds, peak
+      resident set size in MiB.  Groups add up their tests, and show the
+      largest peak.
+    </p>
+    <%
+      columns = ['Tests', 'Wall', 'CPU', 'User', 'System', 'Peak RSS',
+                 'Minor faults', 'Major faults', 'Voluntary switches',
+                 'Involuntary switches']
+    %>
+    % for title, usages in (('Groups', usage_groups), ('Tests', usage_tests)):
+    <h3>${title}</h3>
+    <table class="timing">
+      <thead>
+        <tr>
+          <th class="head" onclick="sortTable(this, 0, false)">Name</th>
+          % for i, column in enumerate(columns):
+          <th class="head" onclick="sortTable(this, ${i + 1}, true)">${column}</th>
+          % endfor
+        </tr>
+      </thead>
+      <tbody>
+        % for usage in usages:
+        <tr>
+          <td><div>${usage.name | h}</div></td>
+          <td>${usage.tests}</td>
+          <td>${'%.3f' % usage.time}</td>
+          <td>${'%.3f' % usage.cpu}</td>
+          <td>${'%.3f' % usage.utime}</td>
+          <td>${'%.3f' % usage.stime}</td>
+          <td>${'%.1f' % (usage.maxrss / 1024.0)}</td>
+          <td>${usage.minflt}</td>
+          <td>${usage.majflt}</td>
+          <td>${usage.nvcsw}</td>
+          <td>${usage.nivcsw}</td>
+        </tr>
+        % endfor
+      </tbody>
+    </table>
+    % endfor
+    % endif
+  </body>
+</html>
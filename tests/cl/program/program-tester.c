@@ -27,6 +27,7 @@
  * Parser and runner for building programs and executing kernels.
  */
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <inttypes.h>
 #include <math.h>
@@ -1591,78 +1592,229 @@ init(const int argc,
 
 /* Buffer functions */
 
+/*
+ * All tests of a program share one buffer per kernel argument index, big
+ * enough for the largest data any test passes through it.  The command
+ * queue executes in order, so the writes of a test only happen after the
+ * reads of the tests enqueued before it, and the buffers can be reused
+ * while those tests are still in flight.
+ *
+ * Since the buffers are reused, a buffer that is only an out argument is
+ * first overwritten with BUFFER_POISON, so a kernel that doesn't write all
+ * of its output can't pass on the results of an earlier test.
+ */
+#define BUFFER_POISON 0xCD
+
 struct buffer_arg {
 	cl_uint index;
+	size_t size;
 	cl_mem buffer;
 };
 
+unsigned int num_buffer_args = 0;
+struct buffer_arg* buffer_args = NULL;
+unsigned char* buffer_poison = NULL;
+
 void
-free_buffer_args(struct buffer_arg** buffer_args, unsigned int* num_buffer_args)
+add_buffer_arg_size(struct test_arg test_arg)
+{
+	int i;
+	struct buffer_arg buffer_arg;
+
+	if(test_arg.type != TEST_ARG_BUFFER || test_arg.value == NULL) {
+		return;
+	}
+
+	for(i = 0; i < num_buffer_args; i++) {
+		if(buffer_args[i].index == test_arg.index) {
+			if(buffer_args[i].size < test_arg.size) {
+				buffer_args[i].size = test_arg.size;
+			}
+			return;
+		}
+	}
+
+	buffer_arg.index = test_arg.index;
+	buffer_arg.size = test_arg.size;
+	buffer_arg.buffer = NULL;
+	add_dynamic_array((void**)&buffer_args,
+	                  &num_buffer_args,
+	                  sizeof(struct buffer_arg),
+	                  &buffer_arg);
+}
+
+void
+free_buffer_args()
+{
+	int i;
+
+	for(i = 0; i < num_buffer_args; i++) {
+		if(buffer_args[i].buffer != NULL) {
+			clReleaseMemObject(buffer_args[i].buffer);
+		}
+	}
+
+	free(buffer_args); buffer_args = NULL;
+	num_buffer_args = 0;
+	free(buffer_poison); buffer_poison = NULL;
+}
+
+bool
+create_buffer_args(const struct piglit_cl_program_test_env* env)
+{
+	int i, j;
+	size_t poison_size = 0;
+
+	for(i = 0; i < num_tests; i++) {
+		for(j = 0; j < tests[i].num_args_in; j++) {
+			add_buffer_arg_size(tests[i].args_in[j]);
+		}
+		for(j = 0; j < tests[i].num_args_out; j++) {
+			add_buffer_arg_size(tests[i].args_out[j]);
+		}
+	}
+
+	for(i = 0; i < num_buffer_args; i++) {
+		if(buffer_args[i].size > poison_size) {
+			poison_size = buffer_args[i].size;
+		}
+	}
+	if(poison_size > 0) {
+		buffer_poison = malloc(poison_size);
+		if(buffer_poison == NULL) {
+			free_buffer_args();
+			return false;
+		}
+		memset(buffer_poison, BUFFER_POISON, poison_size);
+	}
+
+	for(i = 0; i < num_buffer_args; i++) {
+		buffer_args[i].buffer = piglit_cl_create_buffer(env->context,
+		                                                CL_MEM_READ_WRITE,
+		                                                buffer_args[i].size);
+		if(buffer_args[i].buffer == NULL) {
+			free_buffer_args();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+cl_mem
+get_buffer_arg(cl_uint index)
 {
 	int i;
 
-	for(i = 0; i < *num_buffer_args; i++) {
-		clReleaseMemObject((*buffer_args)[i].buffer);
+	for(i = 0; i < num_buffer_args; i++) {
+		if(buffer_args[i].index == index) {
+			return buffer_args[i].buffer;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Results are checked in blocks of elements.  Each block is first
+ * compared with a loop that only accumulates whether anything mismatched,
+ * which the compiler can vectorize, and only a block with a mismatch is
+ * checked again element by element to report it.  The quick comparisons
+ * must fail on everything the piglit_cl_probe_* functions fail on.
+ */
+#define CHECK_BLOCK_SIZE 1024
+
+static inline bool
+integer_mismatch(int64_t value, int64_t expect, uint64_t tolerance)
+{
+	uint64_t diff = value > expect ? (uint64_t)value - (uint64_t)expect
+	                               : (uint64_t)expect - (uint64_t)value;
+
+	return diff > tolerance;
+}
+
+static inline bool
+uinteger_mismatch(uint64_t value, uint64_t expect, uint64_t tolerance)
+{
+	uint64_t diff = value > expect ? value - expect : expect - value;
+
+	return diff > tolerance;
+}
+
+static inline bool
+floating_mismatch(float value, float expect, float tolerance)
+{
+	float diff = value > expect ? value - expect : expect - value;
+
+	/* Same as piglit_cl_probe_floating() */
+	if((isnan(value) && isnan(expect)) ||
+	   (isinf(value) && isinf(expect) && ((value > 0) == (expect > 0)))) {
+		return false;
 	}
 
-	free(*buffer_args); *buffer_args = NULL;
-	*num_buffer_args = 0;
+	return diff > tolerance || isnan(value);
 }
 
 bool
 check_test_arg_value(struct test_arg test_arg,
                      void* value)
 {
+	size_t b; // first element of block
+	size_t end; // end of block
 	size_t i; // index in array
 	size_t c; // component in element
 	size_t ra; // offset from the beginning of parsed array
 	size_t rb; // offset from the beginning of buffer
+	bool mismatch;
 
-#define CASEI(enum_type, type, cl_type)                                     \
-	case enum_type:                                                         \
-		for(i = 0; i < test_arg.length; i++) {                              \
-			for(c = 0; c < test_arg.cl_size; c++) {                         \
-				rb = i*test_arg.cl_mem_size + c;                            \
-				if(!piglit_cl_probe_integer(((cl_type*)value)[rb],          \
-				                            ((cl_type*)test_arg.value)[rb], \
-				                            test_arg.toli)) {               \
-					ra = i*test_arg.cl_size + c;                            \
-					printf("Error at %s[%zu]\n", type, ra);                 \
-					return false;                                           \
-				}                                                           \
-			}                                                               \
-		}                                                                   \
+	/*
+	 * Identical data passes whatever the type and tolerance.  Elements
+	 * with padding, like int3, can differ in the padding.
+	 */
+	if(   test_arg.cl_size == test_arg.cl_mem_size
+	   && memcmp(value, test_arg.value, test_arg.size) == 0) {
 		return true;
-#define CASEU(enum_type, type, cl_type)                                      \
+	}
+
+#define CASE(enum_type, type, cl_type, tolerance, quick_mismatch, probe)      \
 	case enum_type:                                                          \
-		for(i = 0; i < test_arg.length; i++) {                               \
-			for(c = 0; c < test_arg.cl_size; c++) {                          \
-				rb = i*test_arg.cl_mem_size + c;                             \
-				if(!piglit_cl_probe_uinteger(((cl_type*)value)[rb],          \
-				                             ((cl_type*)test_arg.value)[rb], \
-				                             test_arg.tolu)) {               \
-					ra = i*test_arg.cl_size + c;                             \
-					printf("Error at %s[%zu]\n", type, ra);                  \
-					return false;                                            \
+		for(b = 0; b < test_arg.length; b += CHECK_BLOCK_SIZE) {             \
+			end = MIN2(b + CHECK_BLOCK_SIZE, test_arg.length);               \
+			mismatch = false;                                                \
+			for(i = b; i < end; i++) {                                       \
+				for(c = 0; c < test_arg.cl_size; c++) {                      \
+					rb = i*test_arg.cl_mem_size + c;                         \
+					mismatch |= quick_mismatch(((cl_type*)value)[rb],        \
+					                           ((cl_type*)test_arg.value)[rb], \
+					                           tolerance);                   \
 				}                                                            \
 			}                                                                \
-		}                                                                    \
-		return true;
-#define CASEF(enum_type, type, cl_type)                                      \
-	case enum_type:                                                          \
-		for(i = 0; i < test_arg.length; i++) {                               \
-			for(c = 0; c < test_arg.cl_size; c++) {                          \
-				rb = i*test_arg.cl_mem_size + c;                             \
-				if(!piglit_cl_probe_floating(((cl_type*)value)[rb],          \
-				                             ((cl_type*)test_arg.value)[rb], \
-				                             test_arg.tolf)) {               \
-					ra = i*test_arg.cl_size + c;                             \
-					printf("Error at %s[%zu]\n", type, ra);                  \
-					return false;                                            \
+			if(!mismatch) {                                                  \
+				continue;                                                    \
+			}                                                                \
+			for(i = b; i < end; i++) {                                       \
+				for(c = 0; c < test_arg.cl_size; c++) {                      \
+					rb = i*test_arg.cl_mem_size + c;                         \
+					if(!probe(((cl_type*)value)[rb],                         \
+					          ((cl_type*)test_arg.value)[rb],                \
+					          tolerance)) {                                  \
+						ra = i*test_arg.cl_size + c;                         \
+						printf("Error at %s[%zu]\n", type, ra);              \
+						return false;                                        \
+					}                                                        \
 				}                                                            \
 			}                                                                \
 		}                                                                    \
 		return true;
+#define CASEI(enum_type, type, cl_type)                                     \
+	CASE(enum_type, type, cl_type, test_arg.toli,                           \
+	     integer_mismatch, piglit_cl_probe_integer)
+#define CASEU(enum_type, type, cl_type)                                     \
+	CASE(enum_type, type, cl_type, test_arg.tolu,                           \
+	     uinteger_mismatch, piglit_cl_probe_uinteger)
+#define CASEF(enum_type, type, cl_type)                                     \
+	CASE(enum_type, type, cl_type, test_arg.tolf,                           \
+	     floating_mismatch, piglit_cl_probe_floating)
 
 	switch(test_arg.cl_type) {
 		CASEI(TYPE_CHAR,   "char",   cl_char)
@@ -1679,26 +1831,89 @@ check_test_arg_value(struct test_arg test_arg,
 #undef CASEF
 #undef CASEU
 #undef CASEI
+#undef CASE
 
 	return true;
 }
 
 /* Run the kernel test */
-enum piglit_result
-test_kernel(const struct piglit_cl_program_test_config* config,
-            const struct piglit_cl_program_test_env* env,
-            struct test test)
+
+/*
+ * Tests are enqueued ahead of the one being validated, up to this many,
+ * so the device never waits for the results of one test to be checked
+ * before it gets the next.
+ */
+#define MAX_TESTS_IN_FLIGHT 64
+
+/* A test whose commands have been enqueued */
+struct test_run {
+	enum piglit_result result;
+	cl_kernel kernel;
+
+	/* one per out argument */
+	void** read_values;
+	cl_event* read_events;
+
+	/* Why the test couldn't be enqueued, printed when it is run */
+	char error[256];
+};
+
+void
+release_test_run(struct test test, struct test_run* run)
 {
-	enum piglit_result result = PIGLIT_PASS;
+	int j;
+
+	/* Reads write to read_values until they complete */
+	for(j = 0; j < test.num_args_out; j++) {
+		if(run->read_events[j] != NULL) {
+			clWaitForEvents(1, &run->read_events[j]);
+			clReleaseEvent(run->read_events[j]);
+		}
+		free(run->read_values[j]);
+	}
+	free(run->read_events); run->read_events = NULL;
+	free(run->read_values); run->read_values = NULL;
+
+	if(run->kernel != NULL) {
+		clReleaseKernel(run->kernel);
+		run->kernel = NULL;
+	}
+}
+
+/*
+ * Record why a test couldn't be enqueued.  Up to MAX_TESTS_IN_FLIGHT tests
+ * are enqueued ahead of the one being run, so the message is only printed
+ * once the test itself is run.
+ */
+void
+enqueue_error(struct test_run* run, const char* format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(run->error, sizeof(run->error), format, args);
+	va_end(args);
+}
 
-	// all
+/*
+ * Enqueue the writes, the kernel and the reads of a test.  Returns
+ * PIGLIT_PASS if the test is now in flight, or the result of the test if
+ * it couldn't be enqueued.
+ */
+enum piglit_result
+enqueue_test_kernel(const struct piglit_cl_program_test_config* config,
+                    const struct piglit_cl_program_test_env* env,
+                    struct test test,
+                    struct test_run* run)
+{
 	int j;
 	char* kernel_name;
-	cl_kernel kernel;
+	cl_command_queue queue = env->context->command_queues[0];
 
-	// setting/validating arguments
-	struct buffer_arg* buffer_args = NULL;
-	unsigned int  num_buffer_args = 0;
+	run->kernel = NULL;
+	run->error[0] = '\0';
+	run->read_values = calloc(test.num_args_out, sizeof(void*));
+	run->read_events = calloc(test.num_args_out, sizeof(cl_event));
 
 	/* Check if this device supports the local work size. */
 	if (!piglit_cl_framework_check_local_work_size(env->device_id,
@@ -1709,20 +1924,21 @@ test_kernel(const struct piglit_cl_program_test_config* config,
 	/* Create or use apropriate kernel */
 	if(test.kernel_name == NULL) {
 		kernel_name = config->kernel_name;
-		kernel = env->kernel;
 
 		if(config->kernel_name == NULL) {
-			printf("No kernel_name defined\n");
+			enqueue_error(run, "No kernel_name defined\n");
 			return PIGLIT_WARN;
 		} else {
-			clRetainKernel(kernel);
+			run->kernel = env->kernel;
+			clRetainKernel(run->kernel);
 		}
 	} else {
 		kernel_name = test.kernel_name;
-		kernel = piglit_cl_create_kernel(env->program, test.kernel_name);
+		run->kernel = piglit_cl_create_kernel(env->program, test.kernel_name);
 
-		if(kernel == NULL) {
-			printf("Could not create kernel %s\n", kernel_name);
+		if(run->kernel == NULL) {
+			enqueue_error(run, "Could not create kernel %s\n",
+			              kernel_name);
 			return PIGLIT_FAIL;
 		}
 	}
@@ -1738,53 +1954,40 @@ test_kernel(const struct piglit_cl_program_test_config* config,
 
 		switch(test_arg.type) {
 		case TEST_ARG_VALUE:
-			arg_set = piglit_cl_set_kernel_arg(kernel,
+			arg_set = piglit_cl_set_kernel_arg(run->kernel,
 			                                   test_arg.index,
 			                                   test_arg.size,
 			                                   test_arg.value);
 			break;
 		case TEST_ARG_BUFFER: {
-			struct buffer_arg buffer_arg;
-			buffer_arg.index = test_arg.index;
+			cl_mem buffer = NULL;
 
 			if(test_arg.value != NULL) {
-				buffer_arg.buffer = piglit_cl_create_buffer(env->context,
-				                                            CL_MEM_READ_WRITE,
-				                                            test_arg.size);
-				if(   buffer_arg.buffer != NULL
-				   && piglit_cl_write_buffer(env->context->command_queues[0],
-				                             buffer_arg.buffer,
-				                             0,
-				                             test_arg.size,
-				                             test_arg.value)
-				   && piglit_cl_set_kernel_arg(kernel,
-				                               buffer_arg.index,
+				buffer = get_buffer_arg(test_arg.index);
+				if(   piglit_cl_enqueue_write_buffer(queue,
+				                                     buffer,
+				                                     0,
+				                                     test_arg.size,
+				                                     test_arg.value)
+				   && piglit_cl_set_kernel_arg(run->kernel,
+				                               test_arg.index,
 				                               sizeof(cl_mem),
-				                               &buffer_arg.buffer)) {
+				                               &buffer)) {
 					arg_set = true;
 				}
 			} else {
-				buffer_arg.buffer = NULL;
-				arg_set = piglit_cl_set_kernel_arg(kernel,
-				                                   buffer_arg.index,
+				arg_set = piglit_cl_set_kernel_arg(run->kernel,
+				                                   test_arg.index,
 				                                   sizeof(cl_mem),
 				                                   NULL);
 			}
-
-			if(arg_set) {
-				add_dynamic_array((void**)&buffer_args,
-				                  &num_buffer_args,
-				                  sizeof(struct buffer_arg),
-				                  &buffer_arg);
-			}
 			break;
 		}}
 
 		if(!arg_set) {
-			printf("Failed to set kernel argument with index %u\n",
-			       test_arg.index);
-			clReleaseKernel(kernel);
-			free_buffer_args(&buffer_args, &num_buffer_args);
+			enqueue_error(run,
+			              "Failed to set kernel argument with index %u\n",
+			              test_arg.index);
 			return PIGLIT_FAIL;
 		}
 	}
@@ -1799,11 +2002,11 @@ test_kernel(const struct piglit_cl_program_test_config* config,
 			break;
 		case TEST_ARG_BUFFER: {
 			int k;
-			struct buffer_arg buffer_arg;
-			buffer_arg.index = test_arg.index;
+			cl_mem buffer = NULL;
 
-			for(k = 0; k < num_buffer_args; k++) {
-				if(buffer_args[k].index == buffer_arg.index) {
+			/* Already set as an in argument */
+			for(k = 0; k < test.num_args_in; k++) {
+				if(test.args_in[k].index == test_arg.index) {
 					arg_set = true;
 				}
 			}
@@ -1812,61 +2015,82 @@ test_kernel(const struct piglit_cl_program_test_config* config,
 			}
 
 			if(test_arg.value != NULL) {
-				buffer_arg.buffer = piglit_cl_create_buffer(env->context,
-				                                            CL_MEM_READ_WRITE,
-				                                            test_arg.size);
-				if(   buffer_arg.buffer != NULL
-				   && piglit_cl_set_kernel_arg(kernel,
-				                               buffer_arg.index,
-				                               sizeof(cl_mem),
-				                               &buffer_arg.buffer)) {
-					arg_set = true;
+				buffer = get_buffer_arg(test_arg.index);
+				if(!piglit_cl_enqueue_write_buffer(queue,
+				                                   buffer,
+				                                   0,
+				                                   test_arg.size,
+				                                   buffer_poison)) {
+					enqueue_error(run,
+					              "Failed to initialize buffer with index %u\n",
+					              test_arg.index);
+					return PIGLIT_FAIL;
 				}
-			} else {
-				buffer_arg.buffer = NULL;
-				arg_set = piglit_cl_set_kernel_arg(kernel,
-				                                   buffer_arg.index,
-				                                   sizeof(cl_mem),
-				                                   NULL);
-			}
-
-			if(arg_set) {
-				add_dynamic_array((void**)&buffer_args,
-				                  &num_buffer_args,
-				                  sizeof(struct buffer_arg),
-				                  &buffer_arg);
 			}
+			arg_set = piglit_cl_set_kernel_arg(run->kernel,
+			                                   test_arg.index,
+			                                   sizeof(cl_mem),
+			                                   buffer != NULL ? &buffer
+			                                                  : NULL);
 			break;
 		}}
 
 		if(!arg_set) {
-			printf("Failed to set kernel argument with index %u\n",
-			       test_arg.index);
-			clReleaseKernel(kernel);
-			free_buffer_args(&buffer_args, &num_buffer_args);
+			enqueue_error(run,
+			              "Failed to set kernel argument with index %u\n",
+			              test_arg.index);
 			return PIGLIT_FAIL;
 		}
 	}
 
-	/* Execute kernel */
-	printf("Running the kernel...\n");
+	/* Enqueue kernel */
+	printf("Enqueueing the kernel...\n");
 
-	if(!piglit_cl_execute_ND_range_kernel(env->context->command_queues[0],
-	                                      kernel,
+	if(!piglit_cl_enqueue_ND_range_kernel(queue,
+	                                      run->kernel,
 	                                      test.work_dimensions,
 	                                      test.global_work_size,
 	                                      test.local_work_size_null ? NULL : test.local_work_size)) {
-		printf("Failed to enqueue the kernel\n");
-		clReleaseKernel(kernel);
-		free_buffer_args(&buffer_args, &num_buffer_args);
+		enqueue_error(run, "Failed to enqueue the kernel\n");
 		return PIGLIT_FAIL;
 	}
 
-	/* Check results */
+	/* Enqueue reading results */
+	for(j = 0; j < test.num_args_out; j++) {
+		struct test_arg test_arg = test.args_out[j];
+
+		if(test_arg.type != TEST_ARG_BUFFER || test_arg.value == NULL) {
+			continue;
+		}
+
+		run->read_values[j] = malloc(test_arg.size);
+		if(!piglit_cl_enqueue_read_buffer(queue,
+		                                  get_buffer_arg(test_arg.index),
+		                                  0,
+		                                  test_arg.size,
+		                                  run->read_values[j],
+		                                  &run->read_events[j])) {
+			run->read_events[j] = NULL;
+			enqueue_error(run,
+			              "Failed to read kernel argument with index %u\n",
+			              test_arg.index);
+			return PIGLIT_FAIL;
+		}
+	}
+
+	return PIGLIT_PASS;
+}
+
+/* Wait for the results of an enqueued test and check them */
+enum piglit_result
+validate_test_kernel(struct test test, struct test_run* run)
+{
+	enum piglit_result result = PIGLIT_PASS;
+	int j;
+
 	printf("Validating results...\n");
 
 	for(j = 0; j < test.num_args_out; j++) {
-		int k;
 		bool arg_valid = false;
 		struct test_arg test_arg = test.args_out[j];
 
@@ -1875,59 +2099,46 @@ test_kernel(const struct piglit_cl_program_test_config* config,
 			// Not accepted by parser
 			break;
 		case TEST_ARG_BUFFER: {
-			struct buffer_arg buffer_arg;
+			cl_int errNo;
 
-			/* Find the right buffer */
-			for(k = 0; k < num_buffer_args; k++) {
-				if(buffer_args[k].index == test_arg.index) {
-					buffer_arg = buffer_args[k];
-				}
+			if(run->read_events[j] == NULL) {
+				break;
 			}
 
-			if(test_arg.value != NULL) {
-				void* read_value = malloc(test_arg.size);
-
-				if(piglit_cl_read_buffer(env->context->command_queues[0],
-					                     buffer_arg.buffer,
-					                     0,
-					                     test_arg.size,
-					                     read_value)) {
-					arg_valid = true;
-					if(check_test_arg_value(test_arg, read_value)) {
-						printf(" Argument %u: PASS%s\n",
-						                     test_arg.index,
-						                     !test.expect_test_fail ? "" : " (not expected)");
-						if(test.expect_test_fail) {
-							piglit_merge_result(&result, PIGLIT_FAIL);
-						}
-					} else {
-						printf(" Argument %u: FAIL%s\n",
-						                     test_arg.index,
-						                     !test.expect_test_fail ? "" : " (expected)");
-						if(!test.expect_test_fail) {
-							piglit_merge_result(&result, PIGLIT_FAIL);
-						}
-					}
-				}
-
-				free(read_value);
+			errNo = clWaitForEvents(1, &run->read_events[j]);
+			if(!piglit_cl_check_error(errNo, CL_SUCCESS)) {
+				fprintf(stderr,
+				        "Could not wait for kernel to finish: %s\n",
+				        piglit_cl_get_error_name(errNo));
+				break;
 			}
 
+			arg_valid = true;
+			if(check_test_arg_value(test_arg, run->read_values[j])) {
+				printf(" Argument %u: PASS%s\n",
+				                     test_arg.index,
+				                     !test.expect_test_fail ? "" : " (not expected)");
+				if(test.expect_test_fail) {
+					piglit_merge_result(&result, PIGLIT_FAIL);
+				}
+			} else {
+				printf(" Argument %u: FAIL%s\n",
+				                     test_arg.index,
+				                     !test.expect_test_fail ? "" : " (expected)");
+				if(!test.expect_test_fail) {
+					piglit_merge_result(&result, PIGLIT_FAIL);
+				}
+			}
 			break;
 		}}
 
 		if(!arg_valid) {
 			printf("Failed to validate kernel argument with index %u\n",
 			       test_arg.index);
-			clReleaseKernel(kernel);
-			free_buffer_args(&buffer_args, &num_buffer_args);
 			return PIGLIT_FAIL;
 		}
 	}
 
-	/* Clean memory used by test */
-	clReleaseKernel(kernel);
-	free_buffer_args(&buffer_args, &num_buffer_args);
 	return result;
 }
 
@@ -1942,6 +2153,8 @@ piglit_cl_test(const int argc,
 	enum piglit_result result = PIGLIT_SKIP;
 
 	int i;
+	int num_enqueued = 0;
+	struct test_run* runs;
 
 	/* Print building status */
 	if(!config->expect_build_fail) {
@@ -1958,18 +2171,42 @@ piglit_cl_test(const int argc,
 		result = PIGLIT_PASS;
 	}
 
+	if(!create_buffer_args(env)) {
+		printf("Could not create buffers\n");
+		return PIGLIT_FAIL;
+	}
+
 	/* Run the tests */
+	runs = calloc(num_tests, sizeof(struct test_run));
 	for(i = 0; i< num_tests; i++) {
 		enum piglit_result test_result;
 		char* test_name = tests[i].name != NULL ? tests[i].name : "";
 
+		for(; num_enqueued < num_tests &&
+		      num_enqueued < i + MAX_TESTS_IN_FLIGHT; num_enqueued++) {
+			struct test* test = &tests[num_enqueued];
+
+			printf("> Enqueueing kernel test: %s\n",
+			       test->name != NULL ? test->name : "");
+			runs[num_enqueued].result = enqueue_test_kernel(config, env,
+			                                               *test,
+			                                               &runs[num_enqueued]);
+		}
+
 		printf("> Running kernel test: %s\n", test_name);
+		printf("%s", runs[i].error);
 
-		test_result = test_kernel(config, env, tests[i]);
+		test_result = runs[i].result;
+		if(test_result == PIGLIT_PASS) {
+			test_result = validate_test_kernel(tests[i], &runs[i]);
+		}
+		release_test_run(tests[i], &runs[i]);
 		piglit_merge_result(&result, test_result);
 
 		piglit_report_subtest_result(test_result, tests[i].name);
 	}
+	free(runs);
+	free_buffer_args();
 
 	/* Print result */
 	if(num_tests > 0) {
@@ -32,6 +32,8 @@
 // environ.cpp:  implementation of test environment class
 
 #include "environ.h"
+#include "dsfilt.h"
+#include "dsurf.h"
 
 #if defined(__UNIX__)
 #include <sys/stat.h>
@@ -61,4 +63,44 @@ Environment::Environment(Options& opt):
 {
 } // Environment::Environment()
 
+///////////////////////////////////////////////////////////////////////////////
+// Destructor
+///////////////////////////////////////////////////////////////////////////////
+Environment::~Environment() {
+	for (map<WindowKey, Window*>::iterator i = windows.begin();
+	     i != windows.end(); ++i)
+		delete i->second;
+} // Environment::~Environment()
+
+///////////////////////////////////////////////////////////////////////////////
+// selectConfigs:  drawing surface configurations selected by a filter
+///////////////////////////////////////////////////////////////////////////////
+const vector<DrawingSurfaceConfig*>&
+Environment::selectConfigs(const char* filter) {
+	map<string, vector<DrawingSurfaceConfig*> >::iterator i =
+		filteredConfigs.find(filter);
+	if (i != filteredConfigs.end())
+		return i->second;
+
+	DrawingSurfaceFilter f(filter);	// may throw an exception!
+	return filteredConfigs[filter] =
+		f.filter(winSys.surfConfigs, options.maxVisuals);
+} // Environment::selectConfigs
+
+///////////////////////////////////////////////////////////////////////////////
+// reusableWindow:  a window kept for later tests with the same needs
+///////////////////////////////////////////////////////////////////////////////
+Window&
+Environment::reusableWindow(DrawingSurfaceConfig& c, int w, int h) {
+	WindowKey key;
+	key.config = &c;
+	key.width = w;
+	key.height = h;
+
+	Window*& window = windows[key];
+	if (!window)
+		window = new Window(winSys, c, w, h);
+	return *window;
+} // Environment::reusableWindow
+
 } // namespace GLEAN
@@ -41,17 +41,21 @@
 #define __environ_h__
 
 #include <iostream>
+#include <map>
 #include "options.h"
 #include "winsys.h"
 
 namespace GLEAN {
 
 class Image;			// Forward and mutually-recursive references.
+class DrawingSurfaceConfig;
+class Window;
 
 class Environment {
     public:
-    	// Constructors:
+    	// Constructors/Destructor:
 	Environment(Options& opt);
+	~Environment();
 
 	// Exceptions:
 	struct Error { };	// Base class for all errors.
@@ -69,6 +73,39 @@ class Environment {
 
 	WindowSystem winSys;	// The window system providing the OpenGL
 				// implementation under test.
+
+	// Utilities:
+
+	const vector<DrawingSurfaceConfig*>& selectConfigs(const char* filter);
+				// The drawing surface configurations
+				// selected by a filter string.  Computed
+				// once per filter, since many tests share
+				// the same one.  May throw
+				// DrawingSurfaceFilter::Syntax.
+
+	Window& reusableWindow(DrawingSurfaceConfig& c, int w, int h);
+				// A window for the given configuration
+				// and size, created the first time it's
+				// requested and then kept, so that tests
+				// run one after another in the same
+				// process don't create it again.
+
+    private:
+	map<string, vector<DrawingSurfaceConfig*> > filteredConfigs;
+
+	struct WindowKey {
+		DrawingSurfaceConfig* config;
+		int width;
+		int height;
+		bool operator<(const WindowKey& k) const {
+			if (config != k.config)
+				return config < k.config;
+			if (width != k.width)
+				return width < k.width;
+			return height < k.height;
+		}
+	};
+	map<WindowKey, Window*> windows;
 }; // class Environment
 
 } // namespace GLEAN
@@ -32,6 +32,7 @@
 // main.cpp:  main program for Glean
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <string>
@@ -54,6 +55,7 @@ void selectTests(Options& o, vector<string>& allTestNames, int argc,
         char* argv[], int i);
 void usage(char* command);
 void listTests(const Test *tests, bool verbose);
+void runBatch(Environment& e, vector<string>& allTestNames);
 
 int
 main(int argc, char* argv[]) {
@@ -92,6 +94,14 @@ main(int argc, char* argv[]) {
 			selectTests(o, allTestNames, argc, argv, i);
 		} else if (!strcmp(argv[i], "--listtests")) {
 			listTestsMode = true;
+		} else if (!strcmp(argv[i], "--batch")) {
+			o.batch = true;
+		} else if (!strcmp(argv[i], "-j")
+			   || !strcmp(argv[i], "--jobs")) {
+			++i;
+			o.jobs = atoi(mandatoryArg(argc, argv, i));
+			if (o.jobs < 1)
+				usage(argv[0]);
 #	    if defined(__X11__)
 		} else if (!strcmp(argv[i], "-display")
 		    || !strcmp(argv[i], "--display")) {
@@ -119,10 +129,13 @@ main(int argc, char* argv[]) {
 	// results.
 	try {
 		Environment e(o);
-		for (Test* t = Test::testList; t; t = t->nextTest)
-			if (binary_search(o.selectedTests.begin(),
-			    o.selectedTests.end(), t->name))
-				t->run(e);
+		if (o.batch)
+			runBatch(e, allTestNames);
+		else
+			for (Test* t = Test::testList; t; t = t->nextTest)
+				if (binary_search(o.selectedTests.begin(),
+				    o.selectedTests.end(), t->name))
+					t->run(e);
 	}
 #if defined(__X11__)
 	catch (WindowSystem::CantOpenDisplay) {
@@ -258,6 +271,34 @@ listTests(const Test *tests, bool verbose) {
 }
 
 
+// Run the tests named on stdin, one per line, in a single environment, so
+// that the drawing surface configurations are enumerated and filtered,
+// and windows created, only once for all of them.  After each test a
+// "PIGLIT-BATCH-END" line is written to both stderr and stdout, which
+// lets the piglit framework split the output by test.
+void
+runBatch(Environment& e, vector<string>& allTestNames) {
+	string name;
+	while (getline(cin, name)) {
+		if (name.empty())
+			continue;
+
+		if (!binary_search(allTestNames.begin(), allTestNames.end(),
+		    name)) {
+			cerr << "Warning: " << name << " ignored;"
+				" not a valid test name.\n";
+		} else {
+			for (Test* t = Test::testList; t; t = t->nextTest)
+				if (t->name == name)
+					t->run(e);
+		}
+
+		cerr << "PIGLIT-BATCH-END" << endl;
+		cout << "PIGLIT-BATCH-END" << endl;
+	}
+} // runBatch
+
+
 void
 usage(char* command) {
 	cerr << GLEAN::versionString << '\n';
@@ -272,6 +313,11 @@ usage(char* command) {
 "       (-t|--tests) {(+|-)test}   # choose tests to include (+) or exclude (-)\n"
 "       --quick                    # run fewer tests to reduce test time\n"
 "       --listtests                # list test names and exit\n"
+"       --batch                    # run the tests named on stdin, one\n"
+"                                  # per line, ignoring -t\n"
+"       (-j|--jobs) N              # test up to N drawing surface\n"
+"                                  # configurations in parallel, in\n"
+"                                  # separate processes\n"
 "       --help                     # display usage information\n"
 #if defined(__X11__)
 "       -display X11-display-name  # select X11 display to use\n"
@@ -47,6 +47,8 @@ Options::Options() {
 	selectedTests.resize(0);
 	overwrite = false;
 	quick = false;
+	batch = false;
+	jobs = 1;
 #   if defined(__X11__)
 	{
 	char* display = getenv("DISPLAY");
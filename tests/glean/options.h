@@ -75,6 +75,13 @@ class Options {
 
 	bool quick;		// run fewer/quicker tests when possible
 
+	int jobs;		// Number of worker processes testing
+				// drawing surface configs in parallel
+
+	bool batch;		// read the names of the tests to run from
+				// stdin, and keep windows for reuse by
+				// later tests
+
 #if defined(__X11__)
 	string dpyName;		// Name of the X11 display providing the
 				// OpenGL implementation to be tested.
@@ -115,8 +115,10 @@ and tbasic.cpp.
 #define usleep(__usec) Sleep(((__usec) + 999)/1000)
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include "dsconfig.h"
 #include "dsfilt.h"
 #include "dsurf.h"
@@ -125,6 +127,7 @@ and tbasic.cpp.
 #include "rc.h"
 #include "glutils.h"
 #include "misc.h"
+#include "workers.h"
 
 #include "test.h"
 
@@ -287,14 +290,23 @@ public:
 
 		try {
 			// Select the drawing configurations for testing
-			DrawingSurfaceFilter f(filter);
-			vector<DrawingSurfaceConfig*>
-                           configs(f.filter(ws.surfConfigs, environment.options.maxVisuals));
+			const vector<DrawingSurfaceConfig*>&
+				configs(env->selectConfigs(filter));
 
 			if (env->options.quick)
 				testOne = true;
 
+#if defined(__UNIX__)
+			// Test the configs in parallel if asked to.  When
+			// only one config is wanted, the first applicable
+			// one has to be found in order.
+			bool parallel = env->options.jobs > 1 && !testOne;
+#else
+			bool parallel = false;
+#endif
+
 			// Test each config
+			vector<DrawingSurfaceConfig*> workerConfigs;
 			for (vector<DrawingSurfaceConfig*>::const_iterator
 				     p = configs.begin();
 			     p < configs.end();
@@ -305,39 +317,33 @@ public:
 				if ((*p)->samples > 0)
 					continue;
 
-				Window w(ws, **p, fWidth, fHeight);
-				RenderingContext rc(ws, **p);
-				if (!ws.makeCurrent(rc, w)) {
-					// XXX need to throw exception here
-				}
-
-				// Make sure glew is initialized so we can call
-				// GL functions safely.
-				piglit_dispatch_default_init(PIGLIT_DISPATCH_GL);
-
-				// Check if test is applicable to this context
-				if (!isApplicable())
+				if (parallel) {
+					workerConfigs.push_back(*p);
 					continue;
+				}
 
-				// Check for all prerequisite extensions.  Note
-				// that this must be done after the rendering
-				// context has been created and made current!
-				if (!GLUtils::haveExtensions(extensions))
-					continue;
-
-				// Create a result object and run the test:
-				ResultType* r = new ResultType();
-				r->config = *p;
-				runOne(*r, w);
-				logOne(*r);
-
-				// Save the result
-				results.push_back(r);
+				// In batch mode, windows are kept for the
+				// tests that follow; otherwise each
+				// configuration gets a window of its own.
+				bool ran;
+				if (env->options.batch) {
+					ran = runConfig(**p,
+						env->reusableWindow(**p,
+							fWidth, fHeight));
+				} else {
+					Window w(ws, **p, fWidth, fHeight);
+					ran = runConfig(**p, w);
+				}
 
 				// if testOne, skip remaining surface configs
-				if (testOne)
+				if (ran && testOne)
 					break;
 			}
+
+#if defined(__UNIX__)
+			if (parallel)
+				runConfigsInWorkers(workerConfigs);
+#endif
 		}
 		catch (DrawingSurfaceFilter::Syntax e) {
 			env->log << "Syntax error in test's drawing-surface"
@@ -356,6 +362,131 @@ public:
 		hasRun = true;	// Note that we've completed the run
 	}
 
+	// Run the test on one drawing surface configuration, in the given
+	// window.  Returns false if the test isn't applicable to it.
+	bool runConfig(DrawingSurfaceConfig& config, Window& w) {
+		WindowSystem& ws = env->winSys;
+		RenderingContext rc(ws, config);
+		if (!ws.makeCurrent(rc, w)) {
+			// XXX need to throw exception here
+		}
+
+		// Make sure glew is initialized so we can call
+		// GL functions safely.
+		piglit_dispatch_default_init(PIGLIT_DISPATCH_GL);
+
+		// Check if test is applicable to this context
+		if (!isApplicable())
+			return false;
+
+		// Check for all prerequisite extensions.  Note
+		// that this must be done after the rendering
+		// context has been created and made current!
+		if (!GLUtils::haveExtensions(extensions))
+			return false;
+
+		// Create a result object and run the test:
+		ResultType* r = new ResultType();
+		r->config = &config;
+		runOne(*r, w);
+		logOne(*r);
+
+		// Save the result
+		results.push_back(r);
+		return true;
+	}
+
+#if defined(__UNIX__)
+	// Runs the test on one config in a worker process
+	class ConfigJob: public WorkerJob {
+	    public:
+		ConfigJob(BaseTest& t, vector<DrawingSurfaceConfig*>& c):
+			test(t), configs(c) { }
+		virtual bool run(int index, ostream& result) {
+			return test.runConfigInWorker(*configs[index], result);
+		}
+	    private:
+		BaseTest& test;
+		vector<DrawingSurfaceConfig*>& configs;
+	};
+
+	// Run the test on each config in a pool of worker processes, then
+	// log the output and collect the results in config order, so that
+	// both are the same as if the configs had been tested one after
+	// another.
+	void runConfigsInWorkers(vector<DrawingSurfaceConfig*>& configs) {
+		ConfigJob job(*this, configs);
+		vector<WorkerOutput> outputs;
+		runInWorkers(job, configs.size(), env->options.jobs, outputs);
+
+		for (size_t i = 0; i < configs.size(); ++i) {
+			env->log << outputs[i].log;
+			// Rethrown for the caller to log, and to stop at,
+			// as it does when testing the configs serially.
+			if (outputs[i].hasResult &&
+			    outputs[i].result == noContextResult())
+				throw RenderingContext::Error();
+			if (outputs[i].failed) {
+				env->log << name << ":  FAIL "
+					 << configs[i]->conciseDescription()
+					 << "\n\tWorker process exited"
+					 << " abnormally\n";
+				continue;
+			}
+			if (!outputs[i].hasResult)
+				continue;
+
+			ResultType* r = new ResultType();
+			istringstream s(outputs[i].result);
+			if (!r->get(s)) {
+				delete r;
+				continue;
+			}
+			// Use the config the parent enumerated, not a
+			// copy parsed back from the result.
+			delete r->config;
+			r->config = configs[i];
+			results.push_back(r);
+		}
+	}
+
+	// In a worker process, run the test on one config, and write the
+	// result, if any, to ``result''.  The worker must not use the
+	// parent's connection to the window system, so it sets up an
+	// environment of its own and uses the same config from it.
+	bool runConfigInWorker(DrawingSurfaceConfig& config, ostream& result) {
+		vector<DrawingSurfaceConfig*>& parentConfigs =
+			env->winSys.surfConfigs;
+		size_t index = find(parentConfigs.begin(), parentConfigs.end(),
+				    &config) - parentConfigs.begin();
+
+		try {
+			Environment workerEnv(env->options);
+			if (index >= workerEnv.winSys.surfConfigs.size())
+				return false;
+			DrawingSurfaceConfig& workerConfig =
+				*workerEnv.winSys.surfConfigs[index];
+			env = &workerEnv;
+
+			Window w(workerEnv.winSys, workerConfig,
+				 fWidth, fHeight);
+			if (!runConfig(workerConfig, w))
+				return false;
+			results.back()->put(result);
+		}
+		catch (RenderingContext::Error) {
+			// Passed on to the parent, see runConfigsInWorkers().
+			result << noContextResult();
+		}
+		return true;
+	}
+
+	// The result of a worker that couldn't create a rendering context.
+	static const char* noContextResult() {
+		return "no rendering context\n";
+	}
+#endif
+
 	virtual void logPassFail(ResultType& r) {
 		env->log << name << (r.pass ? ":  PASS ": ":  FAIL ");
 	}
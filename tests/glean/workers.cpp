@@ -0,0 +1,273 @@
+// BEGIN_COPYRIGHT -*- glean -*-
+// 
+// Copyright (C) 2013  The Piglit project   All Rights Reserved.
+// 
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the
+// Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+// KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+// AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+// OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+// END_COPYRIGHT
+
+
+
+
+// workers.cpp:  implementation of worker processes
+
+#include "workers.h"
+#include <cstdio>
+#include <sstream>
+
+#if defined(__UNIX__)
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace GLEAN {
+
+#if defined(__UNIX__)
+
+namespace {
+
+struct Worker {
+	pid_t pid;
+	int index;
+	int logFd;		// Read end of the worker's stdout, or -1.
+	int resultFd;		// Read end of the result pipe, or -1.
+};
+
+void
+writeAll(int fd, const string& s) {
+	const char* p = s.data();
+	size_t left = s.size();
+	while (left > 0) {
+		ssize_t n = write(fd, p, left);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		p += n;
+		left -= n;
+	}
+}
+
+// Append what can be read from fd to s.  Returns false at end of file.
+bool
+readSome(int fd, string& s) {
+	char buf[4096];
+	ssize_t n = read(fd, buf, sizeof(buf));
+	if (n < 0 && errno == EINTR)
+		return true;
+	if (n <= 0)
+		return false;
+	s.append(buf, n);
+	return true;
+}
+
+// Run one job in the child process; never returns.
+void
+runChild(WorkerJob& job, int index, int logFd, int resultFd) {
+	dup2(logFd, STDOUT_FILENO);
+	close(logFd);
+
+	ostringstream result;
+	bool hasResult = false;
+	int status = 0;
+	try {
+		hasResult = job.run(index, result);
+	}
+	catch (...) {
+		cerr << "caught an unexpected error in worker process\n";
+		status = 1;
+	}
+	cout.flush();
+	fflush(stdout);
+
+	// A leading marker tells an empty result from none at all.
+	if (hasResult)
+		writeAll(resultFd, "R" + result.str());
+	close(resultFd);
+
+	// Skip the parent's exit handlers and static destructors.
+	_exit(status);
+}
+
+bool
+startWorker(WorkerJob& job, int index, Worker& w) {
+	int logPipe[2];
+	int resultPipe[2];
+
+	if (pipe(logPipe))
+		return false;
+	if (pipe(resultPipe)) {
+		close(logPipe[0]);
+		close(logPipe[1]);
+		return false;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(logPipe[0]);
+		close(resultPipe[0]);
+		runChild(job, index, logPipe[1], resultPipe[1]);
+	}
+
+	close(logPipe[1]);
+	close(resultPipe[1]);
+	if (pid < 0) {
+		close(logPipe[0]);
+		close(resultPipe[0]);
+		return false;
+	}
+
+	w.pid = pid;
+	w.index = index;
+	w.logFd = logPipe[0];
+	w.resultFd = resultPipe[0];
+	return true;
+}
+
+void
+finishWorker(Worker& w, WorkerOutput& out) {
+	int status;
+	while (waitpid(w.pid, &status, 0) < 0 && errno == EINTR)
+		;
+	out.failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	out.hasResult = !out.result.empty() && out.result[0] == 'R';
+	if (out.hasResult)
+		out.result.erase(0, 1);
+}
+
+// Kill a worker that can no longer be waited on, and fail its job.
+void
+abandonWorker(Worker& w, WorkerOutput& out) {
+	kill(w.pid, SIGKILL);
+	if (w.logFd >= 0)
+		close(w.logFd);
+	if (w.resultFd >= 0)
+		close(w.resultFd);
+	while (waitpid(w.pid, NULL, 0) < 0 && errno == EINTR)
+		;
+	out.log += "worker process abandoned: poll() failed\n";
+	out.failed = true;
+}
+
+} // anonymous namespace
+
+
+///////////////////////////////////////////////////////////////////////////////
+// runInWorkers:  run ``count'' jobs in up to ``maxWorkers'' processes
+///////////////////////////////////////////////////////////////////////////////
+void
+runInWorkers(WorkerJob& job, int count, int maxWorkers,
+	     vector<WorkerOutput>& outputs) {
+	WorkerOutput empty;
+	empty.hasResult = false;
+	empty.failed = false;
+	outputs.assign(count, empty);
+
+	// Anything still buffered would be written again by every child.
+	cout.flush();
+	fflush(stdout);
+
+	vector<Worker> running;
+	int next = 0;
+	while (next < count || !running.empty()) {
+		while (next < count && (int) running.size() < maxWorkers) {
+			Worker w;
+			if (startWorker(job, next, w)) {
+				running.push_back(w);
+			} else {
+				outputs[next].log = "could not start a worker "
+					"process\n";
+				outputs[next].failed = true;
+			}
+			++next;
+		}
+		if (running.empty())
+			continue;
+
+		vector<pollfd> fds;
+		for (vector<Worker>::iterator w = running.begin();
+		     w != running.end(); ++w) {
+			pollfd p;
+			p.events = POLLIN;
+			p.revents = 0;
+			if (w->logFd >= 0) {
+				p.fd = w->logFd;
+				fds.push_back(p);
+			}
+			if (w->resultFd >= 0) {
+				p.fd = w->resultFd;
+				fds.push_back(p);
+			}
+		}
+		if (poll(&fds[0], fds.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			// Give up on the running and remaining jobs.
+			for (vector<Worker>::iterator w = running.begin();
+			     w != running.end(); ++w)
+				abandonWorker(*w, outputs[w->index]);
+			for (; next < count; ++next) {
+				outputs[next].log = "worker process not "
+					"started: poll() failed\n";
+				outputs[next].failed = true;
+			}
+			break;
+		}
+
+		for (size_t i = 0; i < fds.size(); ++i) {
+			if (!fds[i].revents)
+				continue;
+			for (vector<Worker>::iterator w = running.begin();
+			     w != running.end(); ++w) {
+				WorkerOutput& out = outputs[w->index];
+				if (fds[i].fd == w->logFd &&
+				    !readSome(w->logFd, out.log)) {
+					close(w->logFd);
+					w->logFd = -1;
+				} else if (fds[i].fd == w->resultFd &&
+					   !readSome(w->resultFd, out.result)) {
+					close(w->resultFd);
+					w->resultFd = -1;
+				}
+			}
+		}
+
+		for (vector<Worker>::iterator w = running.begin();
+		     w != running.end(); ) {
+			if (w->logFd < 0 && w->resultFd < 0) {
+				finishWorker(*w, outputs[w->index]);
+				w = running.erase(w);
+			} else {
+				++w;
+			}
+		}
+	}
+} // runInWorkers
+
+#endif
+
+} // namespace GLEAN
@@ -0,0 +1,79 @@
+// BEGIN_COPYRIGHT -*- glean -*-
+// 
+// Copyright (C) 2013  The Piglit project   All Rights Reserved.
+// 
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the
+// Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+// KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+// PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+// AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+// OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+// END_COPYRIGHT
+
+
+
+// workers.h:  run independent jobs in worker processes
+
+// Some tests run the same code on every drawing surface configuration,
+// and each run is independent of the others.  runInWorkers() runs such
+// jobs in forked worker processes, a few at a time, and collects what
+// each one logged and the result it produced, so that the caller can
+// report them in job order exactly as if they had run one after another.
+//
+// Worker processes need fork(), so runInWorkers() is only available on
+// __UNIX__.
+
+
+#ifndef __workers_h__
+#define __workers_h__
+
+using namespace std;
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace GLEAN {
+
+class WorkerJob {
+    public:
+	virtual ~WorkerJob() { }
+
+	// Run job number ``index''.  Anything logged to stdout is
+	// captured.  If the job produces a result, it writes it to
+	// ``result'' and returns true.
+	virtual bool run(int index, ostream& result) = 0;
+}; // class WorkerJob
+
+struct WorkerOutput {
+	string log;		// What the job wrote to stdout.
+	string result;		// What the job wrote to its result stream.
+	bool hasResult;		// True if the job returned true.
+	bool failed;		// True if the worker died or exited
+				// abnormally.
+};
+
+#if defined(__UNIX__)
+void runInWorkers(WorkerJob& job, int count, int maxWorkers,
+		  vector<WorkerOutput>& outputs);
+#endif
+
+} // namespace GLEAN
+
+#endif // __workers_h__
@@ -32,46 +32,82 @@
  */
 
 #include <errno.h>
+#include <setjmp.h>
 
 #include "piglit-util-gl-common.h"
 
-static unsigned parse_glsl_version_number(const char *str);
+static void set_context_versions(struct piglit_gl_test_config *config,
+				 const char *glsl_version);
+
+static bool batch_mode = false;
+static bool probe_mode = false;
+static struct piglit_gl_test_config batch_context_config;
 
 PIGLIT_GL_TEST_CONFIG_BEGIN
 
-	if (argc > 3) {
+	/* In batch mode, the only argument is the GLSL version that
+	 * selects the context; the tests to run are read from stdin.
+	 */
+	batch_mode = PIGLIT_STRIP_ARG("-batch");
+
+	/* In probe mode, likewise, the only argument is the GLSL version,
+	 * and the extensions of its context are printed.
+	 */
+	probe_mode = PIGLIT_STRIP_ARG("-probe");
+
+	if ((batch_mode || probe_mode) && argc > 1)
+		set_context_versions(&config, argv[1]);
+	else if (argc > 3)
+		set_context_versions(&config, argv[3]);
+	else
+		set_context_versions(&config, NULL);
+
+	batch_context_config = config;
+
+	config.window_width = 200;
+	config.window_height = 100;
+	config.window_visual = PIGLIT_GL_VISUAL_DOUBLE | PIGLIT_GL_VISUAL_RGB;
+
+PIGLIT_GL_TEST_CONFIG_END
+
+static unsigned parse_glsl_version_number(const char *str);
+
+/**
+ * Set the versions of the context needed for shaders of the given GLSL
+ * version.  If glsl_version is NULL, GLSL 1.00 is assumed.
+ */
+static void
+set_context_versions(struct piglit_gl_test_config *config,
+		     const char *glsl_version)
+{
+	if (glsl_version != NULL) {
 		const unsigned int int_version
-			= parse_glsl_version_number(argv[3]);
+			= parse_glsl_version_number(glsl_version);
 		switch (int_version) {
 		case 100:
-			config.supports_gl_compat_version = 10;
-			config.supports_gl_es_version = 20;
+			config->supports_gl_compat_version = 10;
+			config->supports_gl_es_version = 20;
 			break;
 		case 300:
-			config.supports_gl_compat_version = 10;
-			config.supports_gl_es_version = 30;
+			config->supports_gl_compat_version = 10;
+			config->supports_gl_es_version = 30;
 			break;
 		default: {
 			const unsigned int gl_version
 				= required_gl_version_from_glsl_version(int_version);
-			config.supports_gl_compat_version = gl_version;
+			config->supports_gl_compat_version = gl_version;
 			if (gl_version < 31)
-				config.supports_gl_core_version = 0;
+				config->supports_gl_core_version = 0;
 			else
-				config.supports_gl_core_version = gl_version;
+				config->supports_gl_core_version = gl_version;
 		}
 			break;
 		}
 	} else {
-		config.supports_gl_compat_version = 10;
-		config.supports_gl_es_version = 20;
+		config->supports_gl_compat_version = 10;
+		config->supports_gl_es_version = 20;
 	}
-
-	config.window_width = 200;
-	config.window_height = 100;
-	config.window_visual = PIGLIT_GL_VISUAL_DOUBLE | PIGLIT_GL_VISUAL_RGB;
-
-PIGLIT_GL_TEST_CONFIG_END
+}
 
 static char *filename;
 static int expected_pass;
@@ -154,6 +190,11 @@ attach_dummy_shader(GLuint shader_prog, GLenum type)
 		(requested_version == 300) ? "es" : "");
 	shader = piglit_compile_shader_text(type, shader_text);
 	glAttachShader(shader_prog, shader);
+
+	/* In batch mode the process compiles many tests; let the shader
+	 * be freed along with the program.
+	 */
+	glDeleteShader(shader);
 }
 
 
@@ -401,8 +442,12 @@ check_version(unsigned glsl_version)
 }
 
 
-void
-piglit_init(int argc, char**argv)
+/**
+ * Check the requirements of the test described by argc/argv and run it.
+ * This reports the result and never returns.
+ */
+static void
+run_test(int argc, char **argv)
 {
 	const char *glsl_version_string;
 	unsigned glsl_version = 0;
@@ -455,9 +500,122 @@ piglit_init(int argc, char**argv)
 	test();
 }
 
+static jmp_buf batch_jmp;
+
+static void
+batch_report_result(enum piglit_result result)
+{
+	longjmp(batch_jmp, 1);
+}
+
+/**
+ * The context is created for the GLSL version given on the command line,
+ * so a batch can only contain tests whose version selects the same context.
+ */
+static bool
+batch_test_matches_context(int argc, char **argv)
+{
+	struct piglit_gl_test_config config;
+
+	memset(&config, 0, sizeof(config));
+	set_context_versions(&config, argc > 3 ? argv[3] : NULL);
+
+	return config.supports_gl_es_version ==
+		batch_context_config.supports_gl_es_version &&
+	       config.supports_gl_core_version ==
+		batch_context_config.supports_gl_core_version &&
+	       config.supports_gl_compat_version ==
+		batch_context_config.supports_gl_compat_version;
+}
+
+/**
+ * Run every test described on stdin in the current context.
+ *
+ * Each line holds the arguments glslparsertest would otherwise get on its
+ * command line, separated by spaces:
+ *
+ *   <filename> <pass|fail> {GLSL version} {--check-link} {extensions}
+ *
+ * Each test reports its result through piglit_report_result() exactly as
+ * it would in a process of its own, followed by a "PIGLIT-BATCH-END" line
+ * on both stdout and stderr.  A test that needs a different context is not
+ * run; a "PIGLIT-BATCH-REJECT" line is printed instead.
+ */
+static void
+run_batch(const char *program_name)
+{
+	char line[4096];
+
+	piglit_set_report_result_hook(batch_report_result);
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		char *argv[64];
+		int argc = 0;
+		char *arg;
+
+		argv[argc++] = (char *) program_name;
+		for (arg = strtok(line, " \t\r\n");
+		     arg != NULL && argc < ARRAY_SIZE(argv) - 1;
+		     arg = strtok(NULL, " \t\r\n"))
+			argv[argc++] = arg;
+		argv[argc] = NULL;
+
+		if (argc == 1)
+			continue;
+
+		filename = NULL;
+		expected_pass = 0;
+		check_link = 0;
+		requested_version = 110;
+		test_requires_geometry_shader4 = false;
+
+		if (setjmp(batch_jmp) == 0) {
+			if (batch_test_matches_context(argc, argv))
+				run_test(argc, argv);
+			else
+				printf("PIGLIT-BATCH-REJECT: %s\n", argv[1]);
+		}
+
+		fprintf(stderr, "PIGLIT-BATCH-END\n");
+		fflush(stderr);
+		printf("PIGLIT-BATCH-END\n");
+		fflush(stdout);
+	}
+
+	exit(0);
+}
+
+static const char *batch_program_name;
+
+void
+piglit_init(int argc, char**argv)
+{
+	/* Tests are run one at a time by run_batch(). */
+	if (batch_mode) {
+		batch_program_name = argv[0];
+		return;
+	}
+
+	/* Tell the test runner which extensions the context has, so that
+	 * it can skip tests requiring others without starting them (see
+	 * framework/prefilter.py).
+	 */
+	if (probe_mode) {
+		printf("extensions: ");
+		piglit_print_gl_extensions();
+		printf("\n");
+		piglit_report_result(PIGLIT_PASS);
+	}
+
+	run_test(argc, argv);
+}
+
 enum piglit_result
 piglit_display(void)
 {
+	if (batch_mode)
+		run_batch(batch_program_name);
+
 	/* Should never be reached */
 	return PIGLIT_FAIL;
 }
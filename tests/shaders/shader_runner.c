@@ -22,8 +22,10 @@
  */
 
 #include <stdbool.h>
+#include <inttypes.h>
 #include <string.h>
 #include <ctype.h>
+#include <setjmp.h>
 
 #if defined(_WIN32)
 #include <stdlib.h>
@@ -41,14 +43,38 @@ get_required_versions(const char *script_name,
 		      struct piglit_gl_test_config *config);
 GLenum
 decode_drawing_mode(const char *mode_str);
+static int
+strip_bench_arg(int *argc, char **argv);
+
+static bool batch_mode = false;
+static bool probe_mode = false;
+static int bench_iterations = 0;
+static struct piglit_gl_test_config batch_context_config;
 
 PIGLIT_GL_TEST_CONFIG_BEGIN
 
+	/* In batch mode, the script named on the command line only selects
+	 * the context; the scripts to run are read from stdin.
+	 */
+	batch_mode = PIGLIT_STRIP_ARG("-batch");
+
+	/* In probe mode, the script only selects the context, whose
+	 * versions, limits and extensions are printed.
+	 */
+	probe_mode = PIGLIT_STRIP_ARG("-probe");
+
+	/* In benchmark mode, the [test] section is timed over N runs
+	 * after running normally.
+	 */
+	bench_iterations = strip_bench_arg(&argc, argv);
+
 	if (argc > 1)
 		get_required_versions(argv[1], &config);
 	else
 		config.supports_gl_compat_version = 10;
 
+	batch_context_config = config;
+
 	config.window_width = 250;
 	config.window_height = 250;
 	config.window_visual = PIGLIT_GL_VISUAL_RGBA | PIGLIT_GL_VISUAL_DOUBLE;
@@ -91,9 +117,17 @@ GLint geometry_layout_vertices_out = 0;
 
 char *shader_string;
 GLint shader_string_size;
+char *script_text = NULL;
 const char *vertex_data_start = NULL;
 const char *vertex_data_end = NULL;
+char *vertex_data_filename = NULL;
 GLuint prog;
+GLuint vao = 0;
+GLuint arb_vertex_program = 0;
+GLuint arb_fragment_program = 0;
+GLuint textures[256];
+unsigned num_textures = 0;
+unsigned texture_units_used = 0;
 size_t num_vbo_rows = 0;
 bool vbo_present = false;
 bool link_ok = false;
@@ -113,6 +147,7 @@ enum states {
 	fragment_shader_file,
 	fragment_program,
 	vertex_data,
+	vertex_data_file,
 	test,
 };
 
@@ -318,11 +353,17 @@ compile_and_bind_program(GLenum target, const char *start, int len)
 	memcpy(source, start, len);
 	source[len] = 0;
 	prog = piglit_compile_program(target, source);
+	free(source);
 
 	glEnable(target);
 	glBindProgramARB(target, prog);
 	link_ok = true;
 	prog_in_use = true;
+
+	if (target == GL_VERTEX_PROGRAM_ARB)
+		arb_vertex_program = prog;
+	else
+		arb_fragment_program = prog;
 }
 
 /**
@@ -439,6 +480,47 @@ load_shader_file(const char *line)
 }
 
 
+/**
+ * Record the binary vertex data file named in a [vertex data file]
+ * section.  Like shader files, it is looked up relative to the current
+ * directory first and then relative to the script.
+ */
+void
+load_vertex_data_file(const char *line)
+{
+	char buf[256];
+	FILE *f;
+
+	if (vertex_data_filename) {
+		printf("Multiple vertex data files: %s\n", line);
+		piglit_report_result(PIGLIT_FAIL);
+	}
+
+	strcpy_to_space(buf, line);
+
+	f = fopen(buf, "rb");
+	if ((f == NULL) && (path != NULL)) {
+		const size_t len = strlen(path);
+
+		memcpy(buf, path, len);
+		buf[len] = '/';
+		strcpy_to_space(&buf[len + 1], line);
+
+		f = fopen(buf, "rb");
+	}
+
+	if (f == NULL) {
+		strcpy_to_space(buf, line);
+
+		printf("could not load file \"%s\"\n", buf);
+		piglit_report_result(PIGLIT_FAIL);
+	}
+
+	fclose(f);
+	vertex_data_filename = strdup(buf);
+}
+
+
 /**
  * Parse a binary comparison operator and return the matching token
  */
@@ -728,6 +810,9 @@ leave_state(enum states state, const char *line)
 		vertex_data_end = line;
 		break;
 
+	case vertex_data_file:
+		break;
+
 	case test:
 		break;
 
@@ -842,6 +927,11 @@ process_test_script(const char *script_name)
 		piglit_report_result(PIGLIT_FAIL);
 	}
 
+	/* The [test] section is executed in place, so the text must stay
+	 * around until the script is finished.
+	 */
+	script_text = text;
+
 	while (line[0] != '\0') {
 		if (line[0] == '[') {
 			leave_state(state, line);
@@ -878,6 +968,8 @@ process_test_script(const char *script_name)
 			} else if (string_match("[vertex data]", line)) {
 				state = vertex_data;
 				vertex_data_start = NULL;
+			} else if (string_match("[vertex data file]", line)) {
+				state = vertex_data_file;
 			} else if (string_match("[test]", line)) {
 				test_start = strchrnul(line, '\n');
 				if (test_start[0] != '\0')
@@ -919,6 +1011,12 @@ process_test_script(const char *script_name)
 					vertex_data_start = line;
 				break;
 
+			case vertex_data_file:
+				line = eat_whitespace(line);
+				if ((line[0] != '\n') && (line[0] != '#'))
+					load_vertex_data_file(line);
+				break;
+
 			case test:
 				break;
 			}
@@ -1073,6 +1171,36 @@ get_required_versions(const char *script_name,
 	}
 }
 
+/**
+ * Remove "-bench N" from the arguments.  Returns N, or 0 if there is no
+ * such argument.
+ */
+static int
+strip_bench_arg(int *argc, char **argv)
+{
+	int i, iterations;
+
+	for (i = 1; i < *argc - 1; i++) {
+		if (strcmp(argv[i], "-bench") != 0)
+			continue;
+
+		iterations = atoi(argv[i + 1]);
+		if (iterations <= 0) {
+			printf("shader_runner: -bench needs a positive "
+			       "number of runs\n");
+			exit(1);
+		}
+
+		/* Also move the terminating NULL. */
+		memmove(&argv[i], &argv[i + 2],
+			(*argc - i - 1) * sizeof(*argv));
+		*argc -= 2;
+		return iterations;
+	}
+
+	return 0;
+}
+
 void
 get_floats(const char *line, float *f, unsigned count)
 {
@@ -1116,38 +1244,146 @@ check_unsigned_support()
 }
 
 /**
- * Handles uploads of UBO uniforms by mapping the buffer and storing
- * the data.  If the uniform is not in a uniform block, returns false.
+ * The commands of a [test] section.
+ *
+ * compile_test_section() parses the section once, when the script is
+ * loaded, into an array of these.  Uniform locations and offsets are
+ * looked up at that point too, since the program is already linked.
+ * run_test_section() then only has to execute the array, however many
+ * times it runs.
+ *
+ * A command that can't be compiled becomes a CMD_ERROR, whose message
+ * is only reported when it is reached, so that the commands before it
+ * still run.
  */
-bool
-set_ubo_uniform(const char *name, const char *type, const char *line)
-{
-	GLuint uniform_index;
+enum test_command_type {
+	CMD_ERROR,
+	CMD_CLEAR_COLOR,
+	CMD_CLEAR,
+	CMD_CLIP_PLANE,
+	CMD_DRAW_RECT_TEX,
+	CMD_DRAW_RECT,
+	CMD_DRAW_INSTANCED_RECT,
+	CMD_DRAW_ARRAYS,
+	CMD_ENABLE,
+	CMD_DISABLE,
+	CMD_FRUSTUM,
+	CMD_ORTHO,
+	CMD_ORTHO_WINDOW,
+	CMD_PROBE_RGBA,
+	CMD_RELATIVE_PROBE_RGBA,
+	CMD_PROBE_RGB,
+	CMD_RELATIVE_PROBE_RGB,
+	CMD_PROBE_ALL_RGBA,
+	CMD_PROBE_ALL_RGB,
+	CMD_TOLERANCE,
+	CMD_SHADE_MODEL,
+	CMD_TEXTURE_RGBW,
+	CMD_TEXTURE_MIPTREE,
+	CMD_TEXTURE_CHECKERBOARD,
+	CMD_TEXTURE_SHADOW,
+	CMD_TEXPARAMETERI,
+	CMD_TEXPARAMETERF,
+	CMD_UNIFORM,
+	CMD_PARAMETER,
+	CMD_LINK_ERROR,
+	CMD_LINK_SUCCESS,
+};
+
+enum uniform_base_type {
+	UNIFORM_FLOAT,
+	UNIFORM_INT,
+	UNIFORM_UINT,
+};
+
+struct uniform_command {
+	enum uniform_base_type base_type;
+	/** 1 for scalars, else the size of the vector or matrix columns */
+	int cols;
+	/** Rows of a matrix, 1 for scalars and vectors */
+	int rows;
+	/** Location in the default uniform block */
+	GLint loc;
+	/** Uniform block containing the uniform, or -1 */
 	GLint block_index;
+	/** Offset of the uniform (or array element) in the block */
 	GLint offset;
-	char *data;
-	float f[16];
-	int ints[16];
-	unsigned uints[16];
-	int name_len = strlen(name);
+	/** Matrix stride in the block, in floats */
+	GLint matrix_stride;
+	GLint row_major;
+	/**
+	 * If non-NULL, the type is unknown.  This is reported after
+	 * check_unsigned_support(), so that it stays a skip on drivers
+	 * without unsigned uniforms.
+	 */
+	char *type_error;
+};
 
-	if (!num_uniform_blocks)
-		return false;
+struct test_command {
+	enum test_command_type type;
+	/** Whether queued single pixel probes are evaluated first */
+	bool flush_probes;
+	/** Message printed by a CMD_ERROR, and the result it reports */
+	char *error;
+	FILE *error_stream;
+	enum piglit_result error_result;
+	GLenum target;
+	GLenum pname;
+	int i[4];
+	double d[4];
+	union {
+		float f[32];
+		int ints[16];
+		unsigned uints[16];
+	} v;
+	struct uniform_command uniform;
+};
 
-	glGetUniformIndices(prog, 1, &name, &uniform_index);
-	if (uniform_index == GL_INVALID_INDEX) {
-		printf("cannot get index of uniform \"%s\"\n", name);
-		piglit_report_result(PIGLIT_FAIL);
-	}
+static struct test_command *test_commands = NULL;
+static unsigned num_test_commands = 0;
 
-	glGetActiveUniformsiv(prog, 1, &uniform_index,
-			      GL_UNIFORM_BLOCK_INDEX, &block_index);
+/**
+ * Turn \c cmd into a CMD_ERROR printing \c message, which must have been
+ * allocated with malloc.
+ */
+static void
+command_error(struct test_command *cmd, FILE *stream,
+	      enum piglit_result result, char *message)
+{
+	cmd->type = CMD_ERROR;
+	cmd->error = message;
+	cmd->error_stream = stream;
+	cmd->error_result = result;
+}
 
-	if (block_index == -1)
-		return false;
+static void
+free_test_commands(void)
+{
+	unsigned i;
+
+	for (i = 0; i < num_test_commands; i++) {
+		free(test_commands[i].error);
+		free(test_commands[i].uniform.type_error);
+	}
+	free(test_commands);
+	test_commands = NULL;
+	num_test_commands = 0;
+}
+
+/**
+ * Parse the value of a uniform in a uniform block.  Its location in the
+ * buffer is looked up once here; set_ubo_uniform() maps the buffer and
+ * stores the data.
+ */
+static void
+compile_ubo_uniform(struct test_command *cmd, GLuint uniform_index,
+		    const char *name, const char *type, const char *line)
+{
+	struct uniform_command *u = &cmd->uniform;
+	int name_len = strlen(name);
 
 	glGetActiveUniformsiv(prog, 1, &uniform_index,
-			      GL_UNIFORM_OFFSET, &offset);
+			      GL_UNIFORM_OFFSET, &u->offset);
 
 	if (name[name_len - 1] == ']') {
 		GLint stride;
@@ -1158,254 +1394,384 @@ set_ubo_uniform(const char *name, const char *type, const char *line)
 
 		glGetActiveUniformsiv(prog, 1, &uniform_index,
 				      GL_UNIFORM_ARRAY_STRIDE, &stride);
-		offset += stride * strtol(&name[i], NULL, 0);
+		u->offset += stride * strtol(&name[i], NULL, 0);
 	}
 
-	glBindBuffer(GL_UNIFORM_BUFFER,
-		     uniform_block_bos[block_index]);
-	data = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
-	data += offset;
-
 	if (string_match("float", type)) {
-		get_floats(line, f, 1);
-		memcpy(data, f, sizeof(float));
+		u->base_type = UNIFORM_FLOAT;
 	} else if (string_match("int", type)) {
-		get_ints(line, ints, 1);
-		memcpy(data, ints, sizeof(int));
+		u->base_type = UNIFORM_INT;
 	} else if (string_match("uint", type)) {
-		get_uints(line, uints, 1);
-		memcpy(data, uints, sizeof(int));
+		u->base_type = UNIFORM_UINT;
 	} else if (string_match("vec", type)) {
-		int elements = type[3] - '0';
-		get_floats(line, f, elements);
-		memcpy(data, f, elements * sizeof(float));
+		u->base_type = UNIFORM_FLOAT;
+		u->cols = type[3] - '0';
 	} else if (string_match("ivec", type)) {
-		int elements = type[4] - '0';
-		get_ints(line, ints, elements);
-		memcpy(data, ints, elements * sizeof(int));
+		u->base_type = UNIFORM_INT;
+		u->cols = type[4] - '0';
 	} else if (string_match("uvec", type)) {
-		int elements = type[4] - '0';
-		get_uints(line, uints, elements);
-		memcpy(data, uints, elements * sizeof(unsigned));
+		u->base_type = UNIFORM_UINT;
+		u->cols = type[4] - '0';
 	} else if (string_match("mat", type)) {
-		GLint matrix_stride, row_major;
-		int cols = type[3] - '0';
-		int rows = type[4] == 'x' ? type[5] - '0' : cols;
-		int r, c;
-		float *matrixdata = (float *)data;
-
-		assert(cols >= 2 && cols <= 4);
-		assert(rows >= 2 && rows <= 4);
+		u->base_type = UNIFORM_FLOAT;
+		u->cols = type[3] - '0';
+		u->rows = type[4] == 'x' ? type[5] - '0' : u->cols;
 
-		get_floats(line, f, rows * cols);
+		assert(u->cols >= 2 && u->cols <= 4);
+		assert(u->rows >= 2 && u->rows <= 4);
 
 		glGetActiveUniformsiv(prog, 1, &uniform_index,
-				      GL_UNIFORM_MATRIX_STRIDE, &matrix_stride);
+				      GL_UNIFORM_MATRIX_STRIDE,
+				      &u->matrix_stride);
 		glGetActiveUniformsiv(prog, 1, &uniform_index,
-				      GL_UNIFORM_IS_ROW_MAJOR, &row_major);
+				      GL_UNIFORM_IS_ROW_MAJOR, &u->row_major);
 
-		matrix_stride /= sizeof(float);
-
-		for (c = 0; c < cols; c++) {
-			for (r = 0; r < rows; r++) {
-				if (row_major) {
-					matrixdata[matrix_stride * c + r] =
-						f[r * rows + c];
-				} else {
-					matrixdata[matrix_stride * r + c] =
-						f[r * rows + c];
-				}
-			}
-		}
+		u->matrix_stride /= sizeof(float);
 	} else {
-		printf("unknown uniform type \"%s\" for \"%s\"\n", type, name);
-		piglit_report_result(PIGLIT_FAIL);
+		u->cols = 0;
 	}
 
-	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	if (u->cols < 1 || u->cols > 4) {
+		asprintf(&u->type_error,
+			 "unknown uniform type \"%s\" for \"%s\"\n",
+			 type, name);
+		return;
+	}
+
+	switch (u->base_type) {
+	case UNIFORM_FLOAT:
+		get_floats(line, cmd->v.f, u->cols * u->rows);
+		break;
+	case UNIFORM_INT:
+		get_ints(line, cmd->v.ints, u->cols);
+		break;
+	case UNIFORM_UINT:
+		get_uints(line, cmd->v.uints, u->cols);
+		break;
+	}
+}
 
-	return true;
+/**
+ * Size of a vector, or of a matrix dimension, from its digit in a type
+ * name, or 0 if it isn't one.
+ */
+static int
+vector_size(char digit)
+{
+	return digit >= '2' && digit <= '4' ? digit - '0' : 0;
 }
 
-void
-set_uniform(const char *line)
+static void
+compile_uniform(struct test_command *cmd, const char *line)
 {
+	struct uniform_command *u = &cmd->uniform;
 	char name[512];
-	float f[16];
-	int ints[16];
-	unsigned uints[16];
-	GLuint prog;
-	GLint loc;
+	GLuint current_prog;
 	const char *type;
 
-	glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *) &prog);
-
 	type = eat_whitespace(line);
 	line = eat_text(type);
 
 	line = strcpy_to_space(name, eat_whitespace(line));
 
-	if (set_ubo_uniform(name, type, line))
+	cmd->type = CMD_UNIFORM;
+	u->cols = 1;
+	u->rows = 1;
+	u->loc = -1;
+	u->block_index = -1;
+
+	/* Without a program, the command fails in program_must_be_in_use()
+	 * when it runs.
+	 */
+	if (!link_ok || !prog_in_use)
 		return;
 
-	loc = glGetUniformLocation(prog, name);
-	if (loc < 0) {
-		printf("cannot get location of uniform \"%s\"\n",
-		       name);
-		piglit_report_result(PIGLIT_FAIL);
+	if (num_uniform_blocks) {
+		const char *uniform_name = name;
+		GLuint uniform_index;
+
+		glGetUniformIndices(prog, 1, &uniform_name, &uniform_index);
+		if (uniform_index == GL_INVALID_INDEX) {
+			char *message;
+
+			asprintf(&message,
+				 "cannot get index of uniform \"%s\"\n", name);
+			command_error(cmd, stdout, PIGLIT_FAIL, message);
+			return;
+		}
+
+		glGetActiveUniformsiv(prog, 1, &uniform_index,
+				      GL_UNIFORM_BLOCK_INDEX,
+				      &u->block_index);
+		if (u->block_index != -1) {
+			compile_ubo_uniform(cmd, uniform_index, name, type,
+					    line);
+			return;
+		}
 	}
 
-	if (string_match("float", type)) {
-		get_floats(line, f, 1);
-		glUniform1fv(loc, 1, f);
+	glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *) &current_prog);
+	u->loc = glGetUniformLocation(current_prog, name);
+	if (u->loc < 0) {
+		char *message;
+
+		asprintf(&message, "cannot get location of uniform \"%s\"\n",
+			 name);
+		command_error(cmd, stdout, PIGLIT_FAIL, message);
 		return;
+	}
+
+	if (string_match("float", type)) {
+		u->base_type = UNIFORM_FLOAT;
 	} else if (string_match("int", type)) {
-		int val = atoi(line);
-		glUniform1i(loc, val);
-		return;
+		u->base_type = UNIFORM_INT;
 	} else if (string_match("uint", type)) {
-		unsigned val;
-		check_unsigned_support();
-		val = strtoul(line, NULL, 0);
-		glUniform1ui(loc, val);
-		return;
+		u->base_type = UNIFORM_UINT;
 	} else if (string_match("vec", type)) {
-		switch (type[3]) {
-		case '2':
-			get_floats(line, f, 2);
-			glUniform2fv(loc, 1, f);
-			return;
-		case '3':
-			get_floats(line, f, 3);
-			glUniform3fv(loc, 1, f);
-			return;
-		case '4':
-			get_floats(line, f, 4);
-			glUniform4fv(loc, 1, f);
-			return;
-		}
+		u->base_type = UNIFORM_FLOAT;
+		u->cols = vector_size(type[3]);
 	} else if (string_match("ivec", type)) {
-		switch (type[4]) {
-		case '2':
-			get_ints(line, ints, 2);
-			glUniform2iv(loc, 1, ints);
-			return;
-		case '3':
-			get_ints(line, ints, 3);
-			glUniform3iv(loc, 1, ints);
-			return;
-		case '4':
-			get_ints(line, ints, 4);
-			glUniform4iv(loc, 1, ints);
-			return;
-		}
+		u->base_type = UNIFORM_INT;
+		u->cols = vector_size(type[4]);
 	} else if (string_match("uvec", type)) {
-		check_unsigned_support();
-		switch (type[4]) {
-		case '2':
-			get_uints(line, uints, 2);
-			glUniform2uiv(loc, 1, uints);
-			return;
-		case '3':
-			get_uints(line, uints, 3);
-			glUniform3uiv(loc, 1, uints);
-			return;
-		case '4':
-			get_uints(line, uints, 4);
-			glUniform4uiv(loc, 1, uints);
-			return;
-		}
+		u->base_type = UNIFORM_UINT;
+		u->cols = vector_size(type[4]);
 	} else if (string_match("mat", type) && type[3] != '\0') {
-		char cols = type[3];
-		char rows = type[4] == 'x' ? type[5] : cols;
-		switch (cols) {
-		case '2':
-			switch (rows) {
-			case '2':
-				get_floats(line, f, 4);
-				glUniformMatrix2fv(loc, 1, GL_FALSE, f);
-				return;
-			case '3':
-				get_floats(line, f, 6);
-				glUniformMatrix2x3fv(loc, 1, GL_FALSE, f);
-				return;
-			case '4':
-				get_floats(line, f, 8);
-				glUniformMatrix2x4fv(loc, 1, GL_FALSE, f);
-				return;
-			}
-		case '3':
-			switch (rows) {
-			case '2':
-				get_floats(line, f, 6);
-				glUniformMatrix3x2fv(loc, 1, GL_FALSE, f);
-				return;
-			case '3':
-				get_floats(line, f, 9);
-				glUniformMatrix3fv(loc, 1, GL_FALSE, f);
-				return;
-			case '4':
-				get_floats(line, f, 12);
-				glUniformMatrix3x4fv(loc, 1, GL_FALSE, f);
-				return;
-			}
-		case '4':
-			switch (rows) {
-			case '2':
-				get_floats(line, f, 8);
-				glUniformMatrix4x2fv(loc, 1, GL_FALSE, f);
-				return;
-			case '3':
-				get_floats(line, f, 12);
-				glUniformMatrix4x3fv(loc, 1, GL_FALSE, f);
-				return;
-			case '4':
-				get_floats(line, f, 16);
-				glUniformMatrix4fv(loc, 1, GL_FALSE, f);
-				return;
+		u->base_type = UNIFORM_FLOAT;
+		u->cols = vector_size(type[3]);
+		u->rows = vector_size(type[4] == 'x' ? type[5] : type[3]);
+		if (u->rows == 0)
+			u->cols = 0;
+	} else {
+		u->cols = 0;
+	}
+
+	if (u->cols == 0) {
+		char type_name[512];
+
+		strcpy_to_space(type_name, type);
+		asprintf(&u->type_error, "unknown uniform type \"%s\"\n",
+			 type_name);
+		return;
+	}
+
+	switch (u->base_type) {
+	case UNIFORM_FLOAT:
+		get_floats(line, cmd->v.f, u->cols * u->rows);
+		break;
+	case UNIFORM_INT:
+		if (u->cols == 1)
+			cmd->v.ints[0] = atoi(line);
+		else
+			get_ints(line, cmd->v.ints, u->cols);
+		break;
+	case UNIFORM_UINT:
+		get_uints(line, cmd->v.uints, u->cols);
+		break;
+	}
+}
+
+/**
+ * Store the value of a uniform in a uniform block by mapping the buffer.
+ */
+static void
+set_ubo_uniform(const struct test_command *cmd)
+{
+	const struct uniform_command *u = &cmd->uniform;
+	char *data;
+
+	glBindBuffer(GL_UNIFORM_BUFFER,
+		     uniform_block_bos[u->block_index]);
+	data = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
+	data += u->offset;
+
+	if (u->rows == 1) {
+		memcpy(data, cmd->v.f, u->cols * sizeof(float));
+	} else {
+		float *matrixdata = (float *)data;
+		int r, c;
+
+		for (c = 0; c < u->cols; c++) {
+			for (r = 0; r < u->rows; r++) {
+				if (u->row_major) {
+					matrixdata[u->matrix_stride * c + r] =
+						cmd->v.f[r * u->rows + c];
+				} else {
+					matrixdata[u->matrix_stride * r + c] =
+						cmd->v.f[r * u->rows + c];
+				}
 			}
 		}
 	}
 
-	strcpy_to_space(name, type);
-	printf("unknown uniform type \"%s\"\n", name);
-	piglit_report_result(PIGLIT_FAIL);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+}
 
-	return;
+static void
+set_uniform_matrix(const struct uniform_command *u, const float *f)
+{
+	switch (u->cols * 10 + u->rows) {
+	case 22:
+		glUniformMatrix2fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 23:
+		glUniformMatrix2x3fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 24:
+		glUniformMatrix2x4fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 32:
+		glUniformMatrix3x2fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 33:
+		glUniformMatrix3fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 34:
+		glUniformMatrix3x4fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 42:
+		glUniformMatrix4x2fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 43:
+		glUniformMatrix4x3fv(u->loc, 1, GL_FALSE, f);
+		break;
+	case 44:
+		glUniformMatrix4fv(u->loc, 1, GL_FALSE, f);
+		break;
+	default:
+		assert(false);
+		break;
+	}
 }
 
-void
-set_parameter(const char *line)
+static void
+set_uniform(const struct test_command *cmd)
+{
+	const struct uniform_command *u = &cmd->uniform;
+
+	if (u->block_index == -1 && u->base_type == UNIFORM_UINT)
+		check_unsigned_support();
+
+	if (u->type_error != NULL) {
+		fputs(u->type_error, stdout);
+		piglit_report_result(PIGLIT_FAIL);
+	}
+
+	if (u->block_index != -1) {
+		set_ubo_uniform(cmd);
+		return;
+	}
+
+	if (u->rows > 1) {
+		set_uniform_matrix(u, cmd->v.f);
+		return;
+	}
+
+	switch (u->base_type) {
+	case UNIFORM_FLOAT:
+		switch (u->cols) {
+		case 1:
+			glUniform1fv(u->loc, 1, cmd->v.f);
+			break;
+		case 2:
+			glUniform2fv(u->loc, 1, cmd->v.f);
+			break;
+		case 3:
+			glUniform3fv(u->loc, 1, cmd->v.f);
+			break;
+		case 4:
+			glUniform4fv(u->loc, 1, cmd->v.f);
+			break;
+		}
+		break;
+	case UNIFORM_INT:
+		switch (u->cols) {
+		case 1:
+			glUniform1i(u->loc, cmd->v.ints[0]);
+			break;
+		case 2:
+			glUniform2iv(u->loc, 1, cmd->v.ints);
+			break;
+		case 3:
+			glUniform3iv(u->loc, 1, cmd->v.ints);
+			break;
+		case 4:
+			glUniform4iv(u->loc, 1, cmd->v.ints);
+			break;
+		}
+		break;
+	case UNIFORM_UINT:
+		switch (u->cols) {
+		case 1:
+			glUniform1ui(u->loc, cmd->v.uints[0]);
+			break;
+		case 2:
+			glUniform2uiv(u->loc, 1, cmd->v.uints);
+			break;
+		case 3:
+			glUniform3uiv(u->loc, 1, cmd->v.uints);
+			break;
+		case 4:
+			glUniform4uiv(u->loc, 1, cmd->v.uints);
+			break;
+		}
+		break;
+	}
+}
+
+static void
+compile_parameter(struct test_command *cmd, const char *line)
 {
-	float f[4];
-	int index, count;
 	char type[1024];
+	char *message;
+	int count;
 
 	count = sscanf(line, "%s %d (%f , %f , %f , %f)",
-		       type, &index, &f[0], &f[1], &f[2], &f[3]);
+		       type, &cmd->i[0], &cmd->v.f[0], &cmd->v.f[1],
+		       &cmd->v.f[2], &cmd->v.f[3]);
 	if (count != 6) {
-		fprintf(stderr, "Couldn't parse parameter command:\n%s\n", line);
-		piglit_report_result(PIGLIT_FAIL);
+		asprintf(&message, "Couldn't parse parameter command:\n%s\n",
+			 line);
+		command_error(cmd, stderr, PIGLIT_FAIL, message);
+		return;
 	}
 
+	/* pname is GL_TRUE for local parameters. */
+	cmd->type = CMD_PARAMETER;
 	if (string_match("env_vp", type)) {
-		glProgramEnvParameter4fvARB(GL_VERTEX_PROGRAM_ARB, index, f);
+		cmd->target = GL_VERTEX_PROGRAM_ARB;
+		cmd->pname = GL_FALSE;
 	} else if (string_match("local_vp", type)) {
-		glProgramLocalParameter4fvARB(GL_VERTEX_PROGRAM_ARB, index, f);
+		cmd->target = GL_VERTEX_PROGRAM_ARB;
+		cmd->pname = GL_TRUE;
 	} else if (string_match("env_fp", type)) {
-		glProgramEnvParameter4fvARB(GL_FRAGMENT_PROGRAM_ARB, index, f);
+		cmd->target = GL_FRAGMENT_PROGRAM_ARB;
+		cmd->pname = GL_FALSE;
 	} else if (string_match("local_fp", type)) {
-		glProgramLocalParameter4fvARB(GL_FRAGMENT_PROGRAM_ARB, index, f);
+		cmd->target = GL_FRAGMENT_PROGRAM_ARB;
+		cmd->pname = GL_TRUE;
 	} else {
-		fprintf(stderr, "Unknown parameter type `%s'\n", type);
-		piglit_report_result(PIGLIT_FAIL);
+		asprintf(&message, "Unknown parameter type `%s'\n", type);
+		command_error(cmd, stderr, PIGLIT_FAIL, message);
 	}
 }
 
-struct enable_table {
-	const char *name;
-	GLenum value;
-} enable_table[] = {
+static void
+set_parameter(const struct test_command *cmd)
+{
+	if (cmd->pname)
+		glProgramLocalParameter4fvARB(cmd->target, cmd->i[0],
+					      cmd->v.f);
+	else
+		glProgramEnvParameter4fvARB(cmd->target, cmd->i[0],
+					    cmd->v.f);
+}
+
+struct enable_table {
+	const char *name;
+	GLenum value;
+	bool enabled;
+} enable_table[] = {
 	{ "GL_CLIP_PLANE0", GL_CLIP_PLANE0 },
 	{ "GL_CLIP_PLANE1", GL_CLIP_PLANE1 },
 	{ "GL_CLIP_PLANE2", GL_CLIP_PLANE2 },
@@ -1419,26 +1785,54 @@ struct enable_table {
 	{ NULL, 0 }
 };
 
-void
-do_enable_disable(const char *line, bool enable_flag)
+/**
+ * Compile an enable or disable command into the index of its enum in
+ * enable_table.
+ */
+static void
+compile_enable_disable(struct test_command *cmd, const char *line,
+		       bool enable_flag)
 {
 	char name[512];
+	char *message;
 	int i;
 
 	strcpy_to_space(name, eat_whitespace(line));
 	for (i = 0; enable_table[i].name; ++i) {
 		if (0 == strcmp(name, enable_table[i].name)) {
-			if (enable_flag) {
-				glEnable(enable_table[i].value);
-			} else {
-				glDisable(enable_table[i].value);
-			}
+			cmd->type = enable_flag ? CMD_ENABLE : CMD_DISABLE;
+			cmd->i[0] = i;
 			return;
 		}
 	}
 
-	printf("unknown enable/disable enum \"%s\"\n", name);
-	piglit_report_result(PIGLIT_FAIL);
+	asprintf(&message, "unknown enable/disable enum \"%s\"\n", name);
+	command_error(cmd, stdout, PIGLIT_FAIL, message);
+}
+
+static void
+do_enable_disable(int index, bool enable_flag)
+{
+	if (enable_flag) {
+		glEnable(enable_table[index].value);
+	} else {
+		glDisable(enable_table[index].value);
+	}
+	enable_table[index].enabled = enable_flag;
+}
+
+/**
+ * Remember a texture created by the [test] section, so that batch mode can
+ * delete it before running the next script.
+ */
+static void
+record_texture(int unit, GLuint tex)
+{
+	if (num_textures < ARRAY_SIZE(textures))
+		textures[num_textures++] = tex;
+
+	if (unit >= 0 && unit < 32)
+		texture_units_used |= 1u << unit;
 }
 
 static void
@@ -1479,17 +1873,30 @@ struct string_to_enum {
 	GLenum token;
 };
 
-GLenum
-decode_drawing_mode(const char *mode_str)
+static bool
+lookup_drawing_mode(const char *mode_str, GLenum *mode)
 {
 	int i;
 
 	for (i = GL_POINTS; i <= GL_PATCHES; ++i) {
 		const char *name = piglit_get_prim_name(i);
-		if (0 == strcmp(mode_str, name))
-			return i;
+		if (0 == strcmp(mode_str, name)) {
+			*mode = i;
+			return true;
+		}
 	}
 
+	return false;
+}
+
+GLenum
+decode_drawing_mode(const char *mode_str)
+{
+	GLenum mode;
+
+	if (lookup_drawing_mode(mode_str, &mode))
+		return mode;
+
 	printf("unknown drawing mode \"%s\"\n", mode_str);
 	piglit_report_result(PIGLIT_FAIL);
 
@@ -1498,7 +1905,7 @@ decode_drawing_mode(const char *mode_str)
 }
 
 static void
-handle_texparameter(const char *line)
+compile_texparameter(struct test_command *cmd, const char *line)
 {
 	const struct string_to_enum texture_target[] = {
 		{ "1D ",        GL_TEXTURE_1D             },
@@ -1548,6 +1955,7 @@ handle_texparameter(const char *line)
 	GLenum parameter;
 	const char *parameter_name;
 	const struct string_to_enum *strings = NULL;
+	char *message;
 	int i;
 
 	for (i = 0; texture_target[i].name; i++) {
@@ -1560,8 +1968,10 @@ handle_texparameter(const char *line)
 	}
 
 	if (!target) {
-		fprintf(stderr, "bad texture target in `texparameter %s`\n", line);
-		piglit_report_result(PIGLIT_FAIL);
+		asprintf(&message, "bad texture target in `texparameter %s`\n",
+			 line);
+		command_error(cmd, stderr, PIGLIT_FAIL, message);
+		return;
 	}
 
 	if (string_match("compare_func ", line)) {
@@ -1587,27 +1997,36 @@ handle_texparameter(const char *line)
 	} else if (string_match("lod_bias ", line)) {
 #ifdef PIGLIT_USE_OPENGL
 		line += strlen("lod_bias ");
-		glTexParameterf(target, GL_TEXTURE_LOD_BIAS,
-				strtod(line, NULL));
+		cmd->type = CMD_TEXPARAMETERF;
+		cmd->target = target;
+		cmd->pname = GL_TEXTURE_LOD_BIAS;
+		cmd->v.f[0] = strtod(line, NULL);
 		return;
 #else
-		printf("lod_bias feature is only available in desktop GL\n");
-		piglit_report_result(PIGLIT_SKIP);
+		message = strdup("lod_bias feature is only available in "
+				 "desktop GL\n");
+		command_error(cmd, stdout, PIGLIT_SKIP, message);
+		return;
 #endif
 	} else {
-		fprintf(stderr, "unknown texture parameter in `%s'\n", line);
-		piglit_report_result(PIGLIT_FAIL);
+		asprintf(&message, "unknown texture parameter in `%s'\n",
+			 line);
+		command_error(cmd, stderr, PIGLIT_FAIL, message);
+		return;
 	}
 
 	for (i = 0; strings[i].name; i++) {
 		if (string_match(strings[i].name, line)) {
-			glTexParameteri(target, parameter, strings[i].token);
+			cmd->type = CMD_TEXPARAMETERI;
+			cmd->target = target;
+			cmd->pname = parameter;
+			cmd->i[0] = strings[i].token;
 			return;
 		}
 	}
 
-	fprintf(stderr, "Bad %s `%s'\n", parameter_name, line);
-	piglit_report_result(PIGLIT_FAIL);
+	asprintf(&message, "Bad %s `%s'\n", parameter_name, line);
+	command_error(cmd, stderr, PIGLIT_FAIL, message);
 }
 
 static void
@@ -1652,164 +2071,386 @@ program_must_be_in_use(void)
 
 }
 
-enum piglit_result
-piglit_display(void)
+/**
+ * Benchmark mode, enabled with "-bench N".
+ *
+ * Once the [test] section has run and passed, it is run
+ * BENCH_WARMUP_RUNS more times to warm up, then N times while being
+ * timed.  Probes and the commands creating textures are left out of
+ * these runs: the former would mostly time framebuffer reads, and the
+ * latter would create new textures each time.
+ *
+ * Each draw command, and each run of the section as a whole (a "frame"),
+ * is timed on the CPU around the calls, and on the GPU with timestamp
+ * queries (GL 3.3 or GL_ARB_timer_query).  With only GL_EXT_timer_query,
+ * the draws are timed with elapsed time queries, which can't nest, so
+ * there is no GPU time per frame.
+ *
+ * The minimum, median and 95th percentile of each time, in nanoseconds,
+ * are printed as a "measurements" dictionary on a PIGLIT: line, which
+ * the framework stores in the test's result.
+ */
+#define BENCH_WARMUP_RUNS 3
+
+enum bench_timer {
+	BENCH_TIMER_NONE,
+	BENCH_TIMER_TIMESTAMP,
+	BENCH_TIMER_ELAPSED,
+};
+
+
+static struct {
+	bool running;
+	enum bench_timer timer;
+	unsigned num_draws;
+	/** Index of the current run in the samples */
+	unsigned iteration;
+	/** Index of the current draw command in this run */
+	unsigned draw;
+	int64_t draw_start;
+	/**
+	 * For timestamps, the start and end of the frame, then of each
+	 * draw.  For elapsed time, one query per draw.
+	 */
+	GLuint *queries;
+	/**
+	 * Samples of draw d in run i at [d * bench_iterations + i], those
+	 * of the frame at d = num_draws.
+	 */
+	int64_t *cpu_samples;
+	int64_t *gpu_samples;
+} bench;
+
+static bool
+is_draw_command(enum test_command_type type)
+{
+	return type == CMD_DRAW_RECT_TEX ||
+		type == CMD_DRAW_RECT ||
+		type == CMD_DRAW_INSTANCED_RECT ||
+		type == CMD_DRAW_ARRAYS;
+}
+
+static bool
+runs_in_benchmark(enum test_command_type type)
+{
+	switch (type) {
+	case CMD_PROBE_RGBA:
+	case CMD_RELATIVE_PROBE_RGBA:
+	case CMD_PROBE_RGB:
+	case CMD_RELATIVE_PROBE_RGB:
+	case CMD_PROBE_ALL_RGBA:
+	case CMD_PROBE_ALL_RGB:
+	case CMD_TEXTURE_RGBW:
+	case CMD_TEXTURE_MIPTREE:
+	case CMD_TEXTURE_CHECKERBOARD:
+	case CMD_TEXTURE_SHADOW:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static void
+bench_begin_draw(void)
+{
+	switch (bench.timer) {
+	case BENCH_TIMER_TIMESTAMP:
+		glQueryCounter(bench.queries[2 + 2 * bench.draw],
+			       GL_TIMESTAMP);
+		break;
+	case BENCH_TIMER_ELAPSED:
+		glBeginQuery(GL_TIME_ELAPSED, bench.queries[bench.draw]);
+		break;
+	case BENCH_TIMER_NONE:
+		break;
+	}
+
+	bench.draw_start = piglit_time_get_nano();
+}
+
+static void
+bench_end_draw(void)
+{
+	bench.cpu_samples[bench.draw * bench_iterations + bench.iteration] =
+		piglit_time_get_nano() - bench.draw_start;
+
+	switch (bench.timer) {
+	case BENCH_TIMER_TIMESTAMP:
+		glQueryCounter(bench.queries[3 + 2 * bench.draw],
+			       GL_TIMESTAMP);
+		break;
+	case BENCH_TIMER_ELAPSED:
+		glEndQuery(GL_TIME_ELAPSED);
+		break;
+	case BENCH_TIMER_NONE:
+		break;
+	}
+
+	bench.draw++;
+}
+
+static enum bench_timer
+choose_bench_timer(void)
+{
+#ifdef PIGLIT_USE_OPENGL
+	if (gl_version.num >= 33 ||
+	    piglit_is_extension_supported("GL_ARB_timer_query")) {
+		GLint bits;
+
+		/* An implementation may not have a timestamp counter. */
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+		if (bits != 0)
+			return BENCH_TIMER_TIMESTAMP;
+	}
+
+	if (piglit_is_extension_supported("GL_EXT_timer_query"))
+		return BENCH_TIMER_ELAPSED;
+#endif
+
+	return BENCH_TIMER_NONE;
+}
+
+static GLuint64
+get_query_result(GLuint query)
+{
+	GLuint64 result;
+
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+	return result;
+}
+
+/**
+ * Read back the GPU times of the run that just finished.
+ */
+static void
+collect_gpu_samples(void)
+{
+	unsigned frame = bench.num_draws * bench_iterations;
+	unsigned d;
+
+	switch (bench.timer) {
+	case BENCH_TIMER_TIMESTAMP:
+		bench.gpu_samples[frame + bench.iteration] =
+			get_query_result(bench.queries[1]) -
+			get_query_result(bench.queries[0]);
+		for (d = 0; d < bench.num_draws; d++) {
+			bench.gpu_samples[d * bench_iterations +
+					  bench.iteration] =
+				get_query_result(bench.queries[3 + 2 * d]) -
+				get_query_result(bench.queries[2 + 2 * d]);
+		}
+		break;
+	case BENCH_TIMER_ELAPSED:
+		for (d = 0; d < bench.num_draws; d++) {
+			bench.gpu_samples[d * bench_iterations +
+					  bench.iteration] =
+				get_query_result(bench.queries[d]);
+		}
+		break;
+	case BENCH_TIMER_NONE:
+		break;
+	}
+}
+
+static int
+compare_samples(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a;
+	int64_t y = *(const int64_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * Print "'name': {'min': ..., 'median': ..., 'p95': ...}", sorting the
+ * samples on the way.  Percentiles use the nearest rank.
+ */
+static void
+print_bench_stats(const char *name, int64_t *samples)
+{
+	unsigned n = bench_iterations;
+
+	qsort(samples, n, sizeof(*samples), compare_samples);
+	printf("'%s': {'min': %" PRId64 ", 'median': %" PRId64
+	       ", 'p95': %" PRId64 "}",
+	       name, samples[0], samples[(n + 1) / 2 - 1],
+	       samples[(n * 95 + 99) / 100 - 1]);
+}
+
+static void
+print_bench_results(void)
+{
+	unsigned frame = bench.num_draws * bench_iterations;
+	char name[64];
+	unsigned d;
+
+	printf("PIGLIT: {'measurements': {");
+	print_bench_stats("frame cpu", &bench.cpu_samples[frame]);
+	if (bench.timer == BENCH_TIMER_TIMESTAMP) {
+		printf(", ");
+		print_bench_stats("frame gpu", &bench.gpu_samples[frame]);
+	}
+
+	for (d = 0; d < bench.num_draws; d++) {
+		snprintf(name, sizeof(name), "draw %u cpu", d + 1);
+		printf(", ");
+		print_bench_stats(name,
+				  &bench.cpu_samples[d * bench_iterations]);
+		if (bench.timer != BENCH_TIMER_NONE) {
+			snprintf(name, sizeof(name), "draw %u gpu", d + 1);
+			printf(", ");
+			print_bench_stats(name,
+					  &bench.gpu_samples[d *
+							     bench_iterations]);
+		}
+	}
+	printf("}, 'measurement_iterations': %d}\n", bench_iterations);
+	fflush(stdout);
+}
+
+/**
+ * Parse the [test] section into test_commands.  Must be called once the
+ * program is linked and in use, so that uniforms can be looked up.
+ */
+static void
+compile_test_section(void)
 {
 	const char *line;
-	bool pass = true;
-	GLbitfield clear_bits = 0;
-	bool link_error_expected = false;
+	unsigned size = 0;
 
 	if (test_start == NULL)
-		return PIGLIT_PASS;
+		return;
 
 	line = test_start;
 	while (line[0] != '\0') {
-		float c[32];
-		double d[4];
-		int x, y, w, h, l, tex, level;
+		struct test_command *cmd;
+		float *c;
+		int x, w, h, l, tex, level;
 		char s[32];
+		char *message;
 
 		line = eat_whitespace(line);
 
+		if (line[0] == '\0')
+			break;
+
+		if (line[0] == '\n' || line[0] == '#') {
+			line = strchrnul(line, '\n');
+			if (line[0] != '\0')
+				line++;
+			continue;
+		}
+
+		if (num_test_commands == size) {
+			size = size ? size * 2 : 64;
+			test_commands = realloc(test_commands,
+						size * sizeof(*test_commands));
+		}
+		cmd = &test_commands[num_test_commands++];
+		memset(cmd, 0, sizeof(*cmd));
+		c = cmd->v.f;
+
+		/* Single pixel probes are queued and evaluated together
+		 * with one framebuffer read, as soon as any other command
+		 * (which may change the framebuffer) comes along.
+		 */
+		cmd->flush_probes = !string_match("probe rgb", line) &&
+			!string_match("relative probe rgb", line);
+
 		if (string_match("clear color", line)) {
+			cmd->type = CMD_CLEAR_COLOR;
 			get_floats(line + 11, c, 4);
-			glClearColor(c[0], c[1], c[2], c[3]);
-			clear_bits |= GL_COLOR_BUFFER_BIT;
 		} else if (string_match("clear", line)) {
-			glClear(clear_bits);
+			cmd->type = CMD_CLEAR;
 		} else if (sscanf(line,
 				  "clip plane %d %lf %lf %lf %lf",
-				  &x, &d[0], &d[1], &d[2], &d[3])) {
+				  &x, &cmd->d[0], &cmd->d[1], &cmd->d[2],
+				  &cmd->d[3])) {
 			if (x < 0 || x >= GL_MAX_CLIP_PLANES) {
-				printf("clip plane id %d out of range\n", x);
-				piglit_report_result(PIGLIT_FAIL);
+				asprintf(&message,
+					 "clip plane id %d out of range\n", x);
+				command_error(cmd, stdout, PIGLIT_FAIL,
+					      message);
+			} else {
+				cmd->type = CMD_CLIP_PLANE;
+				cmd->target = GL_CLIP_PLANE0 + x;
 			}
-			glClipPlane(GL_CLIP_PLANE0 + x, d);
 		} else if (string_match("draw rect tex", line)) {
-			program_must_be_in_use();
+			cmd->type = CMD_DRAW_RECT_TEX;
 			get_floats(line + 13, c, 8);
-			piglit_draw_rect_tex(c[0], c[1], c[2], c[3],
-					     c[4], c[5], c[6], c[7]);
 		} else if (string_match("draw rect", line)) {
-			program_must_be_in_use();
+			cmd->type = CMD_DRAW_RECT;
 			get_floats(line + 9, c, 4);
-			piglit_draw_rect(c[0], c[1], c[2], c[3]);
 		} else if (string_match("draw instanced rect", line)) {
-			int primcount;
-
-			program_must_be_in_use();
+			cmd->type = CMD_DRAW_INSTANCED_RECT;
 			sscanf(line + 19, "%d %f %f %f %f",
-			       &primcount,
+			       &cmd->i[0],
 			       c + 0, c + 1, c + 2, c + 3);
-			draw_instanced_rect(primcount, c[0], c[1], c[2], c[3]);
-		} else if (sscanf(line, "draw arrays %31s %d %d", s, &x, &y)) {
-			GLenum mode = decode_drawing_mode(s);
-			int first = x;
-			size_t count = (size_t) y;
-			program_must_be_in_use();
-			if (first < 0) {
-				printf("draw arrays 'first' must be >= 0\n");
-				piglit_report_result(PIGLIT_FAIL);
-			} else if (vbo_present &&
-				   (size_t) first >= num_vbo_rows) {
-				printf("draw arrays 'first' must be < %lu\n",
-				       (unsigned long) num_vbo_rows);
-				piglit_report_result(PIGLIT_FAIL);
-			}
-			if (count <= 0) {
-				printf("draw arrays 'count' must be > 0\n");
-				piglit_report_result(PIGLIT_FAIL);
-			} else if (vbo_present &&
-				   count > num_vbo_rows - (size_t) first) {
-				printf("draw arrays cannot draw beyond %lu\n",
-				       (unsigned long) num_vbo_rows);
-				piglit_report_result(PIGLIT_FAIL);
+		} else if (sscanf(line, "draw arrays %31s %d %d", s,
+				  &cmd->i[0], &cmd->i[1])) {
+			if (lookup_drawing_mode(s, &cmd->target)) {
+				cmd->type = CMD_DRAW_ARRAYS;
+			} else {
+				asprintf(&message,
+					 "unknown drawing mode \"%s\"\n", s);
+				command_error(cmd, stdout, PIGLIT_FAIL,
+					      message);
 			}
-			glDrawArrays(mode, first, count);
 		} else if (string_match("disable", line)) {
-			do_enable_disable(line + 7, false);
+			compile_enable_disable(cmd, line + 7, false);
 		} else if (string_match("enable", line)) {
-			do_enable_disable(line + 6, true);
+			compile_enable_disable(cmd, line + 6, true);
 		} else if (string_match("frustum", line)) {
+			cmd->type = CMD_FRUSTUM;
 			get_floats(line + 7, c, 6);
-			piglit_frustum_projection(false, c[0], c[1], c[2],
-						  c[3], c[4], c[5]);
 		} else if (sscanf(line, "ortho %f %f %f %f",
 				  c + 0, c + 1, c + 2, c + 3) == 4) {
-			piglit_gen_ortho_projection(c[0], c[1], c[2], c[3],
-						    -1, 1, GL_FALSE);
+			cmd->type = CMD_ORTHO;
 		} else if (string_match("ortho", line)) {
-			piglit_ortho_projection(piglit_width, piglit_height,
-						GL_FALSE);
+			cmd->type = CMD_ORTHO_WINDOW;
 		} else if (string_match("probe rgba", line)) {
+			cmd->type = CMD_PROBE_RGBA;
 			get_floats(line + 10, c, 6);
-			if (!piglit_probe_pixel_rgba((int) c[0], (int) c[1],
-						    & c[2])) {
-				pass = false;
-			}
 		} else if (sscanf(line,
 				  "relative probe rgba ( %f , %f ) "
 				  "( %f , %f , %f , %f )",
 				  c + 0, c + 1,
 				  c + 2, c + 3, c + 4, c + 5) == 6) {
-			x = c[0] * piglit_width;
-			y = c[1] * piglit_height;
-			if (x >= piglit_width)
-				x = piglit_width - 1;
-			if (y >= piglit_height)
-				y = piglit_height - 1;
-
-			if (!piglit_probe_pixel_rgba(x, y, &c[2])) {
-				pass = false;
-			}
+			cmd->type = CMD_RELATIVE_PROBE_RGBA;
 		} else if (string_match("probe rgb", line)) {
+			cmd->type = CMD_PROBE_RGB;
 			get_floats(line + 9, c, 5);
-			if (!piglit_probe_pixel_rgb((int) c[0], (int) c[1],
-						    & c[2])) {
-				pass = false;
-			}
 		} else if (sscanf(line,
 				  "relative probe rgb ( %f , %f ) "
 				  "( %f , %f , %f )",
 				  c + 0, c + 1,
 				  c + 2, c + 3, c + 4) == 5) {
-			x = c[0] * piglit_width;
-			y = c[1] * piglit_height;
-			if (x >= piglit_width)
-				x = piglit_width - 1;
-			if (y >= piglit_height)
-				y = piglit_height - 1;
-
-			if (!piglit_probe_pixel_rgb(x, y, &c[2])) {
-				pass = false;
-			}
+			cmd->type = CMD_RELATIVE_PROBE_RGB;
 		} else if (string_match("probe all rgba", line)) {
+			cmd->type = CMD_PROBE_ALL_RGBA;
 			get_floats(line + 14, c, 4);
-			pass = pass &&
-				piglit_probe_rect_rgba(0, 0, piglit_width,
-						       piglit_height, c);
 		} else if (string_match("probe all rgb", line)) {
+			cmd->type = CMD_PROBE_ALL_RGB;
 			get_floats(line + 13, c, 3);
-			pass = pass &&
-				piglit_probe_rect_rgb(0, 0, piglit_width,
-						      piglit_height, c);
 		} else if (string_match("tolerance", line)) {
-			get_floats(line + strlen("tolerance"), piglit_tolerance, 4);
+			cmd->type = CMD_TOLERANCE;
+			get_floats(line + strlen("tolerance"), c, 4);
 		} else if (string_match("shade model smooth", line)) {
-			glShadeModel(GL_SMOOTH);
+			cmd->type = CMD_SHADE_MODEL;
+			cmd->target = GL_SMOOTH;
 		} else if (string_match("shade model flat", line)) {
-			glShadeModel(GL_FLAT);
+			cmd->type = CMD_SHADE_MODEL;
+			cmd->target = GL_FLAT;
 		} else if (sscanf(line,
 				  "texture rgbw %d ( %d , %d )",
 				  &tex, &w, &h) == 3) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_rgbw_texture(GL_RGBA, w, h, GL_FALSE, GL_FALSE, GL_UNSIGNED_NORMALIZED);
-			glEnable(GL_TEXTURE_2D);
+			cmd->type = CMD_TEXTURE_RGBW;
+			cmd->i[0] = tex;
+			cmd->i[1] = w;
+			cmd->i[2] = h;
 		} else if (sscanf(line, "texture miptree %d", &tex) == 1) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_miptree_texture();
-			glEnable(GL_TEXTURE_2D);
+			cmd->type = CMD_TEXTURE_MIPTREE;
+			cmd->i[0] = tex;
 		} else if (sscanf(line,
 				  "texture checkerboard %d %d ( %d , %d ) "
 				  "( %f , %f , %f , %f ) "
@@ -1817,104 +2458,375 @@ piglit_display(void)
 				  &tex, &level, &w, &h,
 				  c + 0, c + 1, c + 2, c + 3,
 				  c + 4, c + 5, c + 6, c + 7) == 12) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_checkerboard_texture(0, level,
-						    w, h,
-						    w / 2, h / 2,
-						    c + 0, c + 4);
-			glEnable(GL_TEXTURE_2D);
+			cmd->type = CMD_TEXTURE_CHECKERBOARD;
+			cmd->i[0] = tex;
+			cmd->i[1] = level;
+			cmd->i[2] = w;
+			cmd->i[3] = h;
 		} else if (sscanf(line,
 				  "texture shadow2D %d ( %d , %d )",
 				  &tex, &w, &h) == 3) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_depth_texture(GL_TEXTURE_2D, GL_DEPTH_COMPONENT,
-					     w, h, 1, GL_FALSE);
-			glTexParameteri(GL_TEXTURE_2D,
-					GL_TEXTURE_COMPARE_MODE,
-					GL_COMPARE_R_TO_TEXTURE);
-			glTexParameteri(GL_TEXTURE_2D,
-					GL_TEXTURE_COMPARE_FUNC,
-					GL_GREATER);
-
-			glEnable(GL_TEXTURE_2D);
+			cmd->type = CMD_TEXTURE_SHADOW;
+			cmd->target = GL_TEXTURE_2D;
+			cmd->i[0] = tex;
+			cmd->i[1] = w;
+			cmd->i[2] = h;
+			cmd->i[3] = 1;
 		} else if (sscanf(line,
 				  "texture shadowRect %d ( %d , %d )",
 				  &tex, &w, &h) == 3) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_depth_texture(GL_TEXTURE_RECTANGLE, GL_DEPTH_COMPONENT,
-					     w, h, 1, GL_FALSE);
-			glTexParameteri(GL_TEXTURE_RECTANGLE,
-					GL_TEXTURE_COMPARE_MODE,
-					GL_COMPARE_R_TO_TEXTURE);
-			glTexParameteri(GL_TEXTURE_RECTANGLE,
-					GL_TEXTURE_COMPARE_FUNC,
-					GL_GREATER);
+			cmd->type = CMD_TEXTURE_SHADOW;
+			cmd->target = GL_TEXTURE_RECTANGLE;
+			cmd->i[0] = tex;
+			cmd->i[1] = w;
+			cmd->i[2] = h;
+			cmd->i[3] = 1;
 		} else if (sscanf(line,
 				  "texture shadow1D %d ( %d )",
 				  &tex, &w) == 2) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_depth_texture(GL_TEXTURE_1D, GL_DEPTH_COMPONENT,
-					     w, 1, 1, GL_FALSE);
-			glTexParameteri(GL_TEXTURE_1D,
-					GL_TEXTURE_COMPARE_MODE,
-					GL_COMPARE_R_TO_TEXTURE);
-			glTexParameteri(GL_TEXTURE_1D,
-					GL_TEXTURE_COMPARE_FUNC,
-					GL_GREATER);
+			cmd->type = CMD_TEXTURE_SHADOW;
+			cmd->target = GL_TEXTURE_1D;
+			cmd->i[0] = tex;
+			cmd->i[1] = w;
+			cmd->i[2] = 1;
+			cmd->i[3] = 1;
 		} else if (sscanf(line,
 				  "texture shadow1DArray %d ( %d , %d )",
 				  &tex, &w, &l) == 3) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_depth_texture(GL_TEXTURE_1D_ARRAY, GL_DEPTH_COMPONENT,
-					     w, 1, l, GL_FALSE);
-			glTexParameteri(GL_TEXTURE_1D_ARRAY,
-					GL_TEXTURE_COMPARE_MODE,
-					GL_COMPARE_R_TO_TEXTURE);
-			glTexParameteri(GL_TEXTURE_1D_ARRAY,
-					GL_TEXTURE_COMPARE_FUNC,
-					GL_GREATER);
+			cmd->type = CMD_TEXTURE_SHADOW;
+			cmd->target = GL_TEXTURE_1D_ARRAY;
+			cmd->i[0] = tex;
+			cmd->i[1] = w;
+			cmd->i[2] = 1;
+			cmd->i[3] = l;
 		} else if (sscanf(line,
 				  "texture shadow2DArray %d ( %d , %d , %d )",
 				  &tex, &w, &h, &l) == 4) {
-			glActiveTexture(GL_TEXTURE0 + tex);
-			piglit_depth_texture(GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT,
-					     w, h, l, GL_FALSE);
-			glTexParameteri(GL_TEXTURE_2D_ARRAY,
+			cmd->type = CMD_TEXTURE_SHADOW;
+			cmd->target = GL_TEXTURE_2D_ARRAY;
+			cmd->i[0] = tex;
+			cmd->i[1] = w;
+			cmd->i[2] = h;
+			cmd->i[3] = l;
+		} else if (string_match("texparameter ", line)) {
+			compile_texparameter(cmd,
+					     line + strlen("texparameter "));
+		} else if (string_match("uniform", line)) {
+			compile_uniform(cmd, line + 7);
+		} else if (string_match("parameter ", line)) {
+			compile_parameter(cmd, line + strlen("parameter "));
+		} else if (string_match("link error", line)) {
+			cmd->type = CMD_LINK_ERROR;
+		} else if (string_match("link success", line)) {
+			cmd->type = CMD_LINK_SUCCESS;
+		} else {
+			asprintf(&message, "unknown command \"%s\"\n", line);
+			command_error(cmd, stdout, PIGLIT_FAIL, message);
+		}
+
+		line = strchrnul(line, '\n');
+		if (line[0] != '\0')
+			line++;
+	}
+}
+
+/**
+ * Run the commands of the [test] section once.  Returns false if a probe
+ * failed.
+ */
+static bool
+execute_test_commands(bool *link_error_expected)
+{
+	bool pass = true;
+	GLbitfield clear_bits = 0;
+	unsigned i;
+
+	*link_error_expected = false;
+
+	for (i = 0; i < num_test_commands; i++) {
+		const struct test_command *cmd = &test_commands[i];
+		const float *c = cmd->v.f;
+		size_t count;
+		int x, y;
+
+		if (bench.running) {
+			if (!runs_in_benchmark(cmd->type))
+				continue;
+			if (is_draw_command(cmd->type))
+				bench_begin_draw();
+		}
+
+		if (cmd->flush_probes && piglit_probe_batch_pending() &&
+		    !piglit_probe_batch_flush())
+			pass = false;
+
+		switch (cmd->type) {
+		case CMD_ERROR:
+			fputs(cmd->error, cmd->error_stream);
+			piglit_report_result(cmd->error_result);
+			break;
+		case CMD_CLEAR_COLOR:
+			glClearColor(c[0], c[1], c[2], c[3]);
+			clear_bits |= GL_COLOR_BUFFER_BIT;
+			break;
+		case CMD_CLEAR:
+			glClear(clear_bits);
+			break;
+		case CMD_CLIP_PLANE:
+			glClipPlane(cmd->target, cmd->d);
+			break;
+		case CMD_DRAW_RECT_TEX:
+			program_must_be_in_use();
+			piglit_draw_rect_tex(c[0], c[1], c[2], c[3],
+					     c[4], c[5], c[6], c[7]);
+			break;
+		case CMD_DRAW_RECT:
+			program_must_be_in_use();
+			piglit_draw_rect(c[0], c[1], c[2], c[3]);
+			break;
+		case CMD_DRAW_INSTANCED_RECT:
+			program_must_be_in_use();
+			draw_instanced_rect(cmd->i[0], c[0], c[1], c[2], c[3]);
+			break;
+		case CMD_DRAW_ARRAYS:
+			x = cmd->i[0];
+			count = (size_t) cmd->i[1];
+			program_must_be_in_use();
+			if (x < 0) {
+				printf("draw arrays 'first' must be >= 0\n");
+				piglit_report_result(PIGLIT_FAIL);
+			} else if (vbo_present &&
+				   (size_t) x >= num_vbo_rows) {
+				printf("draw arrays 'first' must be < %lu\n",
+				       (unsigned long) num_vbo_rows);
+				piglit_report_result(PIGLIT_FAIL);
+			}
+			if (count <= 0) {
+				printf("draw arrays 'count' must be > 0\n");
+				piglit_report_result(PIGLIT_FAIL);
+			} else if (vbo_present &&
+				   count > num_vbo_rows - (size_t) x) {
+				printf("draw arrays cannot draw beyond %lu\n",
+				       (unsigned long) num_vbo_rows);
+				piglit_report_result(PIGLIT_FAIL);
+			}
+			glDrawArrays(cmd->target, x, count);
+			break;
+		case CMD_ENABLE:
+			do_enable_disable(cmd->i[0], true);
+			break;
+		case CMD_DISABLE:
+			do_enable_disable(cmd->i[0], false);
+			break;
+		case CMD_FRUSTUM:
+			piglit_frustum_projection(false, c[0], c[1], c[2],
+						  c[3], c[4], c[5]);
+			break;
+		case CMD_ORTHO:
+			piglit_gen_ortho_projection(c[0], c[1], c[2], c[3],
+						    -1, 1, GL_FALSE);
+			break;
+		case CMD_ORTHO_WINDOW:
+			piglit_ortho_projection(piglit_width, piglit_height,
+						GL_FALSE);
+			break;
+		case CMD_PROBE_RGBA:
+			piglit_probe_batch_pixel_rgba((int) c[0], (int) c[1],
+						      & c[2]);
+			break;
+		case CMD_RELATIVE_PROBE_RGBA:
+		case CMD_RELATIVE_PROBE_RGB:
+			x = c[0] * piglit_width;
+			y = c[1] * piglit_height;
+			if (x >= piglit_width)
+				x = piglit_width - 1;
+			if (y >= piglit_height)
+				y = piglit_height - 1;
+
+			if (cmd->type == CMD_RELATIVE_PROBE_RGBA)
+				piglit_probe_batch_pixel_rgba(x, y, &c[2]);
+			else
+				piglit_probe_batch_pixel_rgb(x, y, &c[2]);
+			break;
+		case CMD_PROBE_RGB:
+			piglit_probe_batch_pixel_rgb((int) c[0], (int) c[1],
+						     & c[2]);
+			break;
+		case CMD_PROBE_ALL_RGBA:
+			pass = pass &&
+				piglit_probe_rect_rgba(0, 0, piglit_width,
+						       piglit_height, c);
+			break;
+		case CMD_PROBE_ALL_RGB:
+			pass = pass &&
+				piglit_probe_rect_rgb(0, 0, piglit_width,
+						      piglit_height, c);
+			break;
+		case CMD_TOLERANCE:
+			memcpy(piglit_tolerance, c, 4 * sizeof(float));
+			break;
+		case CMD_SHADE_MODEL:
+			glShadeModel(cmd->target);
+			break;
+		case CMD_TEXTURE_RGBW:
+			glActiveTexture(GL_TEXTURE0 + cmd->i[0]);
+			record_texture(cmd->i[0],
+				       piglit_rgbw_texture(GL_RGBA,
+							   cmd->i[1], cmd->i[2],
+							   GL_FALSE, GL_FALSE,
+							   GL_UNSIGNED_NORMALIZED));
+			glEnable(GL_TEXTURE_2D);
+			break;
+		case CMD_TEXTURE_MIPTREE:
+			glActiveTexture(GL_TEXTURE0 + cmd->i[0]);
+			record_texture(cmd->i[0], piglit_miptree_texture());
+			glEnable(GL_TEXTURE_2D);
+			break;
+		case CMD_TEXTURE_CHECKERBOARD:
+			glActiveTexture(GL_TEXTURE0 + cmd->i[0]);
+			record_texture(cmd->i[0],
+				       piglit_checkerboard_texture(0, cmd->i[1],
+								   cmd->i[2],
+								   cmd->i[3],
+								   cmd->i[2] / 2,
+								   cmd->i[3] / 2,
+								   c + 0, c + 4));
+			glEnable(GL_TEXTURE_2D);
+			break;
+		case CMD_TEXTURE_SHADOW:
+			glActiveTexture(GL_TEXTURE0 + cmd->i[0]);
+			record_texture(cmd->i[0],
+				       piglit_depth_texture(cmd->target,
+							    GL_DEPTH_COMPONENT,
+							    cmd->i[1], cmd->i[2],
+							    cmd->i[3], GL_FALSE));
+			glTexParameteri(cmd->target,
 					GL_TEXTURE_COMPARE_MODE,
 					GL_COMPARE_R_TO_TEXTURE);
-			glTexParameteri(GL_TEXTURE_2D_ARRAY,
+			glTexParameteri(cmd->target,
 					GL_TEXTURE_COMPARE_FUNC,
 					GL_GREATER);
-		} else if (string_match("texparameter ", line)) {
-			handle_texparameter(line + strlen("texparameter "));
-		} else if (string_match("uniform", line)) {
+
+			if (cmd->target == GL_TEXTURE_2D)
+				glEnable(GL_TEXTURE_2D);
+			break;
+		case CMD_TEXPARAMETERI:
+			glTexParameteri(cmd->target, cmd->pname, cmd->i[0]);
+			break;
+		case CMD_TEXPARAMETERF:
+			glTexParameterf(cmd->target, cmd->pname, c[0]);
+			break;
+		case CMD_UNIFORM:
 			program_must_be_in_use();
-			set_uniform(line + 7);
-		} else if (string_match("parameter ", line)) {
-			set_parameter(line + strlen("parameter "));
-		} else if (string_match("link error", line)) {
-			link_error_expected = true;
+			set_uniform(cmd);
+			break;
+		case CMD_PARAMETER:
+			set_parameter(cmd);
+			break;
+		case CMD_LINK_ERROR:
+			*link_error_expected = true;
 			if (link_ok) {
 				printf("shader link error expected, but it was successful!\n");
 				piglit_report_result(PIGLIT_FAIL);
 			}
-		} else if (string_match("link success", line)) {
+			break;
+		case CMD_LINK_SUCCESS:
 			program_must_be_in_use();
-		} else if ((line[0] != '\n') && (line[0] != '\0')
-			   && (line[0] != '#')) {
-			printf("unknown command \"%s\"\n", line);
-			piglit_report_result(PIGLIT_FAIL);
+			break;
 		}
 
-		line = strchrnul(line, '\n');
-		if (line[0] != '\0')
-			line++;
+		if (bench.running && is_draw_command(cmd->type))
+			bench_end_draw();
+	}
+
+	return pass;
+}
+
+static void
+run_benchmark(void)
+{
+	unsigned frame, num_queries, i;
+	bool link_error_expected;
+	int64_t start;
+
+	bench.num_draws = 0;
+	for (i = 0; i < num_test_commands; i++) {
+		if (is_draw_command(test_commands[i].type))
+			bench.num_draws++;
+	}
+	frame = bench.num_draws * bench_iterations;
+
+	bench.timer = choose_bench_timer();
+	if (bench.timer == BENCH_TIMER_TIMESTAMP)
+		num_queries = 2 + 2 * bench.num_draws;
+	else if (bench.timer == BENCH_TIMER_ELAPSED)
+		num_queries = bench.num_draws;
+	else
+		num_queries = 0;
+
+	bench.queries = calloc(num_queries + 1, sizeof(GLuint));
+	if (num_queries)
+		glGenQueries(num_queries, bench.queries);
+	bench.cpu_samples = calloc(frame + bench_iterations, sizeof(int64_t));
+	bench.gpu_samples = calloc(frame + bench_iterations, sizeof(int64_t));
+
+	bench.running = true;
+	for (i = 0; i < BENCH_WARMUP_RUNS + bench_iterations; i++) {
+		/* The warm-up runs are timed like the others, and their
+		 * samples overwritten by the first real one.
+		 */
+		bench.iteration = i < BENCH_WARMUP_RUNS ?
+			0 : i - BENCH_WARMUP_RUNS;
+		bench.draw = 0;
+
+		if (bench.timer == BENCH_TIMER_TIMESTAMP)
+			glQueryCounter(bench.queries[0], GL_TIMESTAMP);
+		start = piglit_time_get_nano();
+
+		execute_test_commands(&link_error_expected);
+
+		bench.cpu_samples[frame + bench.iteration] =
+			piglit_time_get_nano() - start;
+		if (bench.timer == BENCH_TIMER_TIMESTAMP)
+			glQueryCounter(bench.queries[1], GL_TIMESTAMP);
+
+		collect_gpu_samples();
 	}
+	bench.running = false;
+
+	print_bench_results();
+
+	if (num_queries)
+		glDeleteQueries(num_queries, bench.queries);
+	free(bench.queries);
+	free(bench.cpu_samples);
+	free(bench.gpu_samples);
+	bench.queries = NULL;
+	bench.cpu_samples = NULL;
+	bench.gpu_samples = NULL;
+}
+
+static enum piglit_result
+run_test_section(void)
+{
+	bool pass;
+	bool link_error_expected;
+
+	if (test_start == NULL)
+		return PIGLIT_PASS;
+
+	pass = execute_test_commands(&link_error_expected);
+
+	if (!piglit_probe_batch_flush())
+		pass = false;
 
 	if (!link_ok && !link_error_expected) {
 		program_must_be_in_use();
 	}
 
+	if (bench_iterations > 0 && pass)
+		run_benchmark();
+
 	piglit_present_results();
 
 	if (piglit_automatic) {
@@ -1927,6 +2839,298 @@ piglit_display(void)
 }
 
 
+static const char *
+script_directory(const char *script_name)
+{
+#if defined(_WIN32)
+	char drive[_MAX_DRIVE];
+	char dir[_MAX_DIR];
+	char fname[_MAX_FNAME];
+	char ext[_MAX_EXT];
+	char* scriptpath;
+	_splitpath(script_name, drive, dir, fname, ext);
+	scriptpath = malloc(strlen(drive) + strlen(dir) + 1);
+	strcpy(scriptpath, drive);
+	strcat(scriptpath, dir);
+	return scriptpath;
+#else
+	/* Because dirname()'s memory handling is unpredictable, we
+	 * must copy both its input and ouput. */
+	char* scriptpath = strdup(script_name);
+	const char *dir = strdup(dirname(scriptpath));
+	free(scriptpath);
+	return dir;
+#endif
+}
+
+static void
+load_test_script(const char *script_name)
+{
+	process_test_script(script_name);
+	link_and_use_shaders();
+	if (link_ok && (vertex_data_start != NULL ||
+			vertex_data_filename != NULL)) {
+		program_must_be_in_use();
+		if (gl_version.num >= 31) {
+			glGenVertexArrays(1, &vao);
+			glBindVertexArray(vao);
+		}
+
+		if (vertex_data_filename != NULL)
+			num_vbo_rows = setup_vbo_from_file(prog,
+							   vertex_data_filename);
+		else
+			num_vbo_rows = setup_vbo_from_text(prog,
+							   vertex_data_start,
+							   vertex_data_end);
+		if (num_vbo_rows == PIGLIT_VBO_ERROR)
+			piglit_report_result(PIGLIT_FAIL);
+		vbo_present = true;
+	}
+	setup_ubos();
+	compile_test_section();
+}
+
+/**
+ * Delete the GL objects created by the current script and restore the GL
+ * state it may have changed, so that the next script in a batch starts out
+ * the same way it would in a fresh process.
+ */
+static void
+reset_test_state(void)
+{
+	unsigned i;
+
+	piglit_probe_batch_discard();
+
+	glUseProgram(0);
+	if (prog != 0) {
+		glDeleteProgram(prog);
+		prog = 0;
+	}
+
+	/* Shaders are normally deleted at link time, but a script may
+	 * have failed before getting that far.
+	 */
+	for (i = 0; i < num_vertex_shaders; i++) {
+		if (glIsShader(vertex_shaders[i]))
+			glDeleteShader(vertex_shaders[i]);
+	}
+	for (i = 0; i < num_geometry_shaders; i++) {
+		if (glIsShader(geometry_shaders[i]))
+			glDeleteShader(geometry_shaders[i]);
+	}
+	for (i = 0; i < num_fragment_shaders; i++) {
+		if (glIsShader(fragment_shaders[i]))
+			glDeleteShader(fragment_shaders[i]);
+	}
+	num_vertex_shaders = 0;
+	num_geometry_shaders = 0;
+	num_fragment_shaders = 0;
+
+	if (arb_vertex_program != 0) {
+		glDisable(GL_VERTEX_PROGRAM_ARB);
+		glDeleteProgramsARB(1, &arb_vertex_program);
+		arb_vertex_program = 0;
+	}
+	if (arb_fragment_program != 0) {
+		glDisable(GL_FRAGMENT_PROGRAM_ARB);
+		glDeleteProgramsARB(1, &arb_fragment_program);
+		arb_fragment_program = 0;
+	}
+
+	if (num_uniform_blocks != 0) {
+		glDeleteBuffers(num_uniform_blocks, uniform_block_bos);
+		free(uniform_block_bos);
+		uniform_block_bos = NULL;
+		num_uniform_blocks = 0;
+	}
+
+	if (vbo_present) {
+		GLuint vbo;
+
+		if (vao == 0) {
+			GLint max_attribs;
+
+			glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attribs);
+			for (i = 0; i < (unsigned) max_attribs; i++)
+				glDisableVertexAttribArray(i);
+		}
+
+		/* setup_vbo_from_text() leaves its buffer bound. */
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint *) &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDeleteBuffers(1, &vbo);
+		vbo_present = false;
+		num_vbo_rows = 0;
+	}
+	if (vao != 0) {
+		glBindVertexArray(0);
+		glDeleteVertexArrays(1, &vao);
+		vao = 0;
+	}
+
+	glDeleteTextures(num_textures, textures);
+	num_textures = 0;
+#ifdef PIGLIT_USE_OPENGL
+	if (!piglit_is_core_profile) {
+		for (i = 0; i < 32; i++) {
+			if (texture_units_used & (1u << i)) {
+				glActiveTexture(GL_TEXTURE0 + i);
+				glDisable(GL_TEXTURE_2D);
+			}
+		}
+	}
+#endif
+	texture_units_used = 0;
+	glActiveTexture(GL_TEXTURE0);
+
+	for (i = 0; enable_table[i].name; ++i) {
+		if (enable_table[i].enabled) {
+			glDisable(enable_table[i].value);
+			enable_table[i].enabled = false;
+		}
+	}
+
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+#ifdef PIGLIT_USE_OPENGL
+	if (!piglit_is_core_profile) {
+		glShadeModel(GL_SMOOTH);
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+	}
+#endif
+	for (i = 0; i < 4; i++)
+		piglit_tolerance[i] = 0.01;
+
+	piglit_reset_gl_error();
+
+	free_test_commands();
+	free(script_text);
+	script_text = NULL;
+	test_start = NULL;
+	shader_string = NULL;
+	vertex_data_start = NULL;
+	vertex_data_end = NULL;
+	free(vertex_data_filename);
+	vertex_data_filename = NULL;
+	free(prog_err_info);
+	prog_err_info = NULL;
+	link_ok = false;
+	prog_in_use = false;
+	memset(&glsl_req_version, 0, sizeof(glsl_req_version));
+	geometry_layout_input_type = GL_TRIANGLES;
+	geometry_layout_output_type = GL_TRIANGLE_STRIP;
+	geometry_layout_vertices_out = 0;
+	free((char *) path);
+	path = NULL;
+}
+
+/**
+ * Print what the context offers for each kind of line in a [require]
+ * section, one "name: value" line each.  The test runner reads this to
+ * skip scripts whose requirements can't be met without starting them
+ * (see framework/prefilter.py).
+ */
+static void
+print_context_info(void)
+{
+	printf("GL: %s\n", version_string(&gl_version));
+	printf("GLSL: %s\n", version_string(&glsl_version));
+	printf("GL_MAX_FRAGMENT_UNIFORM_COMPONENTS: %d\n",
+	       gl_max_fragment_uniform_components);
+	printf("GL_MAX_VERTEX_UNIFORM_COMPONENTS: %d\n",
+	       gl_max_vertex_uniform_components);
+	printf("extensions: ");
+	piglit_print_gl_extensions();
+	printf("\n");
+}
+
+static jmp_buf batch_jmp;
+
+static void
+batch_report_result(enum piglit_result result)
+{
+	longjmp(batch_jmp, 1);
+}
+
+/**
+ * The context is created for the script named on the command line, so a
+ * batch can only contain scripts whose requirements select the same context.
+ */
+static bool
+batch_script_matches_context(const char *script_name)
+{
+	struct piglit_gl_test_config config;
+
+	memset(&config, 0, sizeof(config));
+	get_required_versions(script_name, &config);
+
+	return config.supports_gl_es_version ==
+		batch_context_config.supports_gl_es_version &&
+	       config.supports_gl_core_version ==
+		batch_context_config.supports_gl_core_version &&
+	       config.supports_gl_compat_version ==
+		batch_context_config.supports_gl_compat_version;
+}
+
+/**
+ * Run every script named on stdin, one path per line, in the current
+ * context.
+ *
+ * Each script reports its result through piglit_report_result() exactly as
+ * it would in a process of its own.  The output of each script is followed
+ * by a "PIGLIT-BATCH-END" line on both stdout and stderr so the caller can
+ * tell where one script's output ends and the next begins.  A script that
+ * needs a different context is not run; a "PIGLIT-BATCH-REJECT" line is
+ * printed instead.
+ */
+static void
+run_batch(void)
+{
+	char script_name[4096];
+
+	piglit_set_report_result_hook(batch_report_result);
+
+	while (fgets(script_name, sizeof(script_name), stdin) != NULL) {
+		script_name[strcspn(script_name, "\r\n")] = '\0';
+		if (script_name[0] == '\0')
+			continue;
+
+		if (setjmp(batch_jmp) == 0) {
+			if (batch_script_matches_context(script_name)) {
+				path = script_directory(script_name);
+				load_test_script(script_name);
+				piglit_report_result(run_test_section());
+			} else {
+				printf("PIGLIT-BATCH-REJECT: %s\n",
+				       script_name);
+			}
+		}
+
+		reset_test_state();
+
+		fprintf(stderr, "PIGLIT-BATCH-END\n");
+		fflush(stderr);
+		printf("PIGLIT-BATCH-END\n");
+		fflush(stdout);
+	}
+
+	piglit_set_report_result_hook(NULL);
+	exit(0);
+}
+
+enum piglit_result
+piglit_display(void)
+{
+	if (batch_mode)
+		run_batch();
+
+	return run_test_section();
+}
+
 void
 piglit_init(int argc, char **argv)
 {
@@ -1957,46 +3161,24 @@ piglit_init(int argc, char **argv)
 	gl_max_fragment_uniform_components *= 4;
 	gl_max_vertex_uniform_components *= 4;
 #endif
-	if (argc > 2) {
-		path = argv[2];
-	} else if (argc > 1) {
-#if defined(_WIN32)
-		char drive[_MAX_DRIVE];
-		char dir[_MAX_DIR];
-		char fname[_MAX_FNAME];
-		char ext[_MAX_EXT];
-		char* scriptpath;
-		_splitpath(argv[1], drive, dir, fname, ext);
-		scriptpath = malloc(strlen(drive) + strlen(dir) + 1);
-		strcpy(scriptpath, drive);
-		strcat(scriptpath, dir);
-		path = scriptpath;
-#else
-		/* Because dirname()'s memory handling is unpredictable, we
-		 * must copy both its input and ouput. */
-		char* scriptpath = strdup(argv[1]);
-		path = strdup(dirname(scriptpath));
-		free(scriptpath);
-#endif
-	} else {
+	if (argc < 2) {
 		printf("shader_runner: missing arguments\n");
 		exit(1);
 	}
 
-	process_test_script(argv[1]);
-	link_and_use_shaders();
-	if (link_ok && vertex_data_start != NULL) {
-		program_must_be_in_use();
-		if (gl_version.num >= 31) {
-			GLuint vao;
-
-			glGenVertexArrays(1, &vao);
-			glBindVertexArray(vao);
-		}
+	/* Scripts are loaded one at a time by run_batch(). */
+	if (batch_mode)
+		return;
 
-		num_vbo_rows = setup_vbo_from_text(prog, vertex_data_start,
-						   vertex_data_end);
-		vbo_present = true;
+	if (probe_mode) {
+		print_context_info();
+		piglit_report_result(PIGLIT_PASS);
 	}
-	setup_ubos();
+
+	if (argc > 2)
+		path = argv[2];
+	else
+		path = script_directory(argv[1]);
+
+	load_test_script(argv[1]);
 }
@@ -1064,6 +1064,14 @@ static GLboolean test_format_npot_swizzle(const struct format_desc *format,
 {
 	GLboolean pass;
 
+	if (!piglit_should_run_subtest("%s%s%s%s%s", format->name,
+				       npot ? ", NPOT" : "",
+				       texswizzle ? ", swizzled" : "",
+				       texture_proj ? ", projected" : "",
+				       test_border_color ? ", border color only" : "")) {
+		return GL_TRUE;
+	}
+
 	if (has_texture_swizzle) {
 		update_swizzle(texswizzle);
 	}
@@ -136,8 +136,16 @@
 # - An function, reset_dispatch_pointers(), which resets each dispatch
 #   pointer to the corresponding stub function.
 #
-# - A table function_names, containing the name of each function in
-#   alphabetical order (including the "gl" prefix).
+# - A table function_names, containing the name of each function
+#   (including the "gl" prefix), laid out as a minimal perfect hash
+#   table: function_names[function_name_hash(name, seed) %
+#   ARRAY_SIZE(function_names)] is name, where seed is
+#   function_name_seeds[function_name_hash(name, 0) %
+#   ARRAY_SIZE(function_name_seeds)].  function_name_hash() (FNV-1a,
+#   with the seed mixed into the offset basis) is implemented in
+#   piglit-dispatch.c.
+#
+# - A table function_name_seeds, containing the seeds described above.
 #
 # - A table function_resolvers, containing a pointer to the resolve
 #   function corresponding to each entry in function_names.
@@ -564,19 +572,79 @@ def generate_dispatch_pointer_resetter(dispatch_sets):
     return ''.join(result)
 
 
-# Generate the function_names and function_resolvers tables.
+# Must match function_name_hash() in piglit-dispatch.c.
+def function_name_hash(name, seed):
+    h = (2166136261 ^ seed) & 0xffffffff
+    for c in name:
+        h = ((h ^ ord(c)) * 16777619) & 0xffffffff
+    return h
+
+
+# Compute a minimal perfect hash of names, using the "hash and
+# displace" method: names are split into buckets by
+# function_name_hash(name, 0), and starting with the largest bucket,
+# each bucket gets the first seed that places all its names into free
+# slots of the table.
+#
+# Returns a list of seeds, one per bucket, and a list giving the index
+# into names that each table slot holds.
+#
+# The names must be unique: no seed can place two equal names in
+# different slots, so the search would never end.
+def compute_perfect_hash(names):
+    assert len(set(names)) == len(names), \
+        'duplicate function names: {0}'.format(
+            sorted(set(n for n in names if names.count(n) > 1)))
+    num_names = len(names)
+    num_buckets = max(1, num_names // 4)
+    buckets = [[] for _ in xrange(num_buckets)]
+    for i, name in enumerate(names):
+        buckets[function_name_hash(name, 0) % num_buckets].append(i)
+
+    seeds = [0] * num_buckets
+    slots = [None] * num_names
+    for b in sorted(xrange(num_buckets), key = lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            break
+        seed = 1
+        while True:
+            positions = [function_name_hash(names[i], seed) % num_names
+                         for i in buckets[b]]
+            if len(set(positions)) == len(positions) and \
+                    all(slots[p] is None for p in positions):
+                break
+            seed += 1
+        seeds[b] = seed
+        for i, p in zip(buckets[b], positions):
+            slots[p] = i
+
+    return seeds, slots
+
+
+# Generate the function_names, function_name_seeds and
+# function_resolvers tables.
 def generate_function_names_and_resolvers(dispatch_sets):
     name_resolver_pairs = []
     for ds in dispatch_sets:
         for _, f in ds.cat_fn_pairs:
             name_resolver_pairs.append((f.gl_name, ds.resolve_name))
-    name_resolver_pairs.sort()
+    # A function that is in both GL and GLES is listed once per
+    # category, with the same resolver.
+    name_resolver_pairs = sorted(set(name_resolver_pairs))
+    seeds, slots = compute_perfect_hash(
+        [name for name, _ in name_resolver_pairs])
+    name_resolver_pairs = [name_resolver_pairs[i] for i in slots]
     result = []
     result.append('static const char * const function_names[] = {\n')
     for name, _ in name_resolver_pairs:
         result.append('\t"{0}",\n'.format(name))
     result.append('};\n')
     result.append('\n')
+    result.append('static const uint32_t function_name_seeds[] = {\n')
+    for seed in seeds:
+        result.append('\t{0},\n'.format(seed))
+    result.append('};\n')
+    result.append('\n')
     result.append('static const piglit_dispatch_resolver_ptr '
                   'function_resolvers[] = {\n')
     for _, resolver in name_resolver_pairs:
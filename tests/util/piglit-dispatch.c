@@ -75,6 +75,19 @@ static bool is_initialized = false;
 
 static piglit_dispatch_api dispatch_api;
 
+/**
+ * Resolution statistics, printed at exit if the PIGLIT_DISPATCH_STATS
+ * environment variable is set.
+ */
+static struct {
+	/** Calls to get_core_proc() and get_ext_proc(). */
+	unsigned proc_lookups;
+	/** Calls to piglit_dispatch_resolve_function(). */
+	unsigned resolve_calls;
+	/** ...of which were answered from resolved_functions. */
+	unsigned resolve_cache_hits;
+} stats;
+
 /**
  * Generated code calls this function to verify that the dispatch
  * mechanism has been properly initialized.
@@ -135,6 +148,7 @@ static piglit_dispatch_function_ptr
 get_core_proc(const char *name, int gl_10x_version)
 {
 	piglit_dispatch_function_ptr function_pointer = get_core_proc_address(name, gl_10x_version);
+	stats.proc_lookups++;
 	if (function_pointer == NULL)
 		get_proc_address_failure(name);
 	return function_pointer;
@@ -148,6 +162,7 @@ static piglit_dispatch_function_ptr
 get_ext_proc(const char *name)
 {
 	piglit_dispatch_function_ptr function_pointer = get_ext_proc_address(name);
+	stats.proc_lookups++;
 	if (function_pointer == NULL)
 		get_proc_address_failure(name);
 	return function_pointer;
@@ -173,8 +188,42 @@ check_extension(const char *name)
 	return piglit_is_extension_supported(name);
 }
 
+/**
+ * Hash function of the function_names perfect hash table.
+ *
+ * This is FNV-1a with \c seed mixed into the offset basis.  It must match
+ * function_name_hash() in gen_dispatch.py.
+ */
+static uint32_t
+function_name_hash(const char *name, uint32_t seed)
+{
+	uint32_t hash = 2166136261u ^ seed;
+
+	while (*name != '\0')
+		hash = (hash ^ (unsigned char) *name++) * 16777619u;
+
+	return hash;
+}
+
 #include "generated_dispatch.c"
 
+/**
+ * Pointers returned by piglit_dispatch_resolve_function(), indexed like
+ * function_names.  Cleared when piglit_dispatch_init() is called again.
+ */
+static piglit_dispatch_function_ptr
+resolved_functions[ARRAY_SIZE(function_names)];
+
+static void
+print_dispatch_stats(void)
+{
+	fprintf(stderr,
+		"piglit-dispatch: %u proc address lookups, "
+		"%u resolve calls (%u cached)\n",
+		stats.proc_lookups, stats.resolve_calls,
+		stats.resolve_cache_hits);
+}
+
 /**
  * Initialize the dispatch mechanism.
  *
@@ -242,6 +291,9 @@ piglit_dispatch_init(piglit_dispatch_api api,
 	/* No need to reset the dispatch pointers the first time */
 	if (is_initialized) {
 		reset_dispatch_pointers();
+		memset(resolved_functions, 0, sizeof(resolved_functions));
+	} else if (getenv("PIGLIT_DISPATCH_STATS") != NULL) {
+		atexit(print_dispatch_stats);
 	}
 
 	is_initialized = true;
@@ -257,13 +309,17 @@ piglit_dispatch_init(piglit_dispatch_api api,
 }
 
 /**
- * Compare two strings in the function_names table.
+ * Return the index of \c name in function_names, or -1 if it isn't a
+ * known function.
  */
-static int compare_function_names(const void *x, const void *y)
+static int
+lookup_function_name(const char *name)
 {
-	const char *x_str = *(const char * const *) x;
-	const char *y_str = *(const char * const *) y;
-	return strcmp(x_str, y_str);
+	uint32_t seed = function_name_seeds[function_name_hash(name, 0) %
+					    ARRAY_SIZE(function_name_seeds)];
+	uint32_t i = function_name_hash(name, seed) % ARRAY_SIZE(function_names);
+
+	return strcmp(function_names[i], name) == 0 ? (int) i : -1;
 }
 
 /**
@@ -288,17 +344,18 @@ static int compare_function_names(const void *x, const void *y)
 piglit_dispatch_function_ptr
 piglit_dispatch_resolve_function(const char *name)
 {
-	size_t item_size = sizeof(function_names[0]);
-	size_t num_items = ARRAY_SIZE(function_names);
-	const char * const *item = (const char * const *)
-		bsearch(&name, function_names, num_items, item_size,
-			compare_function_names);
+	int item_index = lookup_function_name(name);
 	check_initialized();
-	if (!item) {
+	stats.resolve_calls++;
+	if (item_index < 0) {
 		unsupported(name);
 		return NULL;
+	} else if (resolved_functions[item_index] != NULL) {
+		stats.resolve_cache_hits++;
+		return resolved_functions[item_index];
 	} else {
-		size_t item_index = item - function_names;
-		return function_resolvers[item_index]();
+		resolved_functions[item_index] =
+			function_resolvers[item_index]();
+		return resolved_functions[item_index];
 	}
 }
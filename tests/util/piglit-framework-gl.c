@@ -76,7 +76,8 @@ process_args(int *argc, char *argv[], unsigned *force_samples)
 {
 	int j;
 
-	/* Find/remove "-auto" and "-fbo" from the argument vector.
+	/* Find/remove "-auto", "-fbo" and the other common options from
+	 * the argument vector.
 	 */
 	for (j = 1; j < *argc; j++) {
 		if (!strcmp(argv[j], "-auto")) {
@@ -120,6 +121,20 @@ process_args(int *argc, char *argv[], unsigned *force_samples)
 			*force_samples = atoi(argv[j]+9);
 			delete_arg(argv, *argc, j--);
 			*argc -= 1;
+		} else if (!strcmp(argv[j], "-list-subtests")) {
+			piglit_enable_subtest_listing();
+			delete_arg(argv, *argc, j--);
+			*argc -= 1;
+		} else if (!strcmp(argv[j], "-subtest")) {
+			if (j + 1 >= *argc) {
+				fprintf(stderr,
+					"-subtest requires an argument\n");
+				piglit_report_result(PIGLIT_FAIL);
+			}
+			piglit_select_subtest(argv[j + 1]);
+			delete_arg(argv, *argc, j);
+			delete_arg(argv, *argc - 1, j--);
+			*argc -= 2;
 		}
 	}
 }
@@ -22,6 +22,12 @@
  */
 
 #include <inttypes.h>
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 #include "piglit-util-cl.h"
 
@@ -497,13 +503,23 @@ bool
 piglit_cl_is_platform_extension_supported(cl_platform_id platform,
                                           const char *name)
 {
-	char* extensions = piglit_cl_get_platform_info(platform,
-	                                               CL_PLATFORM_EXTENSIONS);
-	bool supported = piglit_is_extension_in_string(extensions, name);
+	/* Extension set of the platform that was queried last. */
+	static cl_platform_id cached_platform = NULL;
+	static struct piglit_extension_set *cached_set = NULL;
 
-	free(extensions);
+	if (cached_set == NULL || platform != cached_platform) {
+		char* extensions =
+			piglit_cl_get_platform_info(platform,
+			                            CL_PLATFORM_EXTENSIONS);
 
-	return supported;
+		piglit_extension_set_destroy(cached_set);
+		cached_set = piglit_extension_set_create(extensions);
+		cached_platform = platform;
+
+		free(extensions);
+	}
+
+	return piglit_extension_set_contains(cached_set, name);
 }
 
 void
@@ -528,12 +544,22 @@ piglit_cl_require_not_platform_extension(cl_platform_id platform,
 bool
 piglit_cl_is_device_extension_supported(cl_device_id device, const char *name)
 {
-	char* extensions = piglit_cl_get_device_info(device, CL_DEVICE_EXTENSIONS);
-	bool supported = piglit_is_extension_in_string(extensions, name);
+	/* Extension set of the device that was queried last. */
+	static cl_device_id cached_device = NULL;
+	static struct piglit_extension_set *cached_set = NULL;
 
-	free(extensions);
+	if (cached_set == NULL || device != cached_device) {
+		char* extensions = piglit_cl_get_device_info(device,
+		                                             CL_DEVICE_EXTENSIONS);
 
-	return supported;
+		piglit_extension_set_destroy(cached_set);
+		cached_set = piglit_extension_set_create(extensions);
+		cached_device = device;
+
+		free(extensions);
+	}
+
+	return piglit_extension_set_contains(cached_set, name);
 }
 
 void
@@ -742,6 +768,288 @@ piglit_cl_release_context(piglit_cl_context context)
 	free(context);
 }
 
+/*
+ * Program binary cache
+ *
+ * If PIGLIT_CL_PROGRAM_CACHE names a directory, programs successfully
+ * built from source are stored there as binaries, and later builds of
+ * the same source with the same options on the same devices and driver
+ * load the binary instead of compiling again.
+ *
+ * The key of an entry is a hash of the source, the build options, the
+ * platform version and the name, vendor, driver and version of each
+ * device.  Headers the source includes are not part of it, so programs
+ * that use #include or -I are never cached.  The file is named after a
+ * hash of the key, and the key itself is stored in the file and compared
+ * on load, so colliding hashes only miss the cache.  Binaries the driver
+ * rejects are quietly rebuilt from source and replace the entry.
+ */
+
+#define PROGRAM_CACHE_MAGIC "piglit cl program cache 1\n"
+
+static bool
+program_cacheable(cl_uint count, char** strings, const char* options)
+{
+	unsigned int i;
+
+	if(options != NULL && strstr(options, "-I") != NULL) {
+		return false;
+	}
+	for(i = 0; i < count; i++) {
+		if(strstr(strings[i], "#include") != NULL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static uint64_t
+fnv1a_64(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = data;
+	size_t i;
+
+	for(i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= UINT64_C(0x100000001b3);
+	}
+
+	return hash;
+}
+
+#define FNV1A_64_INIT UINT64_C(0xcbf29ce484222325)
+
+static void
+append_string(char** str, size_t* length, const char* append)
+{
+	size_t append_length = strlen(append);
+
+	*str = realloc(*str, *length + append_length + 1);
+	memcpy(*str + *length, append, append_length + 1);
+	*length += append_length;
+}
+
+static void
+append_info_line(char** str, size_t* length, const char* name, char* value)
+{
+	append_string(str, length, name);
+	append_string(str, length, ": ");
+	append_string(str, length, value != NULL ? value : "");
+	append_string(str, length, "\n");
+	free(value);
+}
+
+static char*
+program_cache_key(piglit_cl_context context, cl_uint count, char** strings,
+                  const char* options)
+{
+	char* key = NULL;
+	size_t key_length = 0;
+	char source_hash[64];
+	uint64_t hash = FNV1A_64_INIT;
+	size_t source_length = 0;
+	unsigned int i;
+
+	for(i = 0; i < count; i++) {
+		size_t length = strlen(strings[i]);
+
+		hash = fnv1a_64(hash, strings[i], length);
+		source_length += length;
+	}
+	snprintf(source_hash, sizeof(source_hash), "%lu %016"PRIx64,
+	         (unsigned long)source_length, hash);
+
+	append_info_line(&key, &key_length, "source", strdup(source_hash));
+	append_info_line(&key, &key_length, "options",
+	                 strdup(options != NULL ? options : ""));
+	append_info_line(&key, &key_length, "platform",
+	                 piglit_cl_get_platform_info(context->platform_id,
+	                                             CL_PLATFORM_VERSION));
+	for(i = 0; i < context->num_devices; i++) {
+		cl_device_id device = context->device_ids[i];
+
+		append_info_line(&key, &key_length, "device",
+		                 piglit_cl_get_device_info(device, CL_DEVICE_NAME));
+		append_info_line(&key, &key_length, "vendor",
+		                 piglit_cl_get_device_info(device, CL_DEVICE_VENDOR));
+		append_info_line(&key, &key_length, "driver",
+		                 piglit_cl_get_device_info(device, CL_DRIVER_VERSION));
+		append_info_line(&key, &key_length, "version",
+		                 piglit_cl_get_device_info(device, CL_DEVICE_VERSION));
+	}
+
+	return key;
+}
+
+static char*
+program_cache_path(const char* dir, const char* key)
+{
+	size_t size = strlen(dir) + 32;
+	char* path = malloc(size);
+
+	snprintf(path, size, "%s/%016"PRIx64".bin",
+	         dir, fnv1a_64(FNV1A_64_INIT, key, strlen(key)));
+
+	return path;
+}
+
+static cl_program
+program_cache_load(piglit_cl_context context, const char* path,
+                   const char* key, const char* options)
+{
+	FILE* file;
+	char magic[sizeof(PROGRAM_CACHE_MAGIC) - 1];
+	uint64_t key_length;
+	char* stored_key = NULL;
+	uint64_t num_devices;
+	size_t* lengths = NULL;
+	unsigned char** binaries = NULL;
+	cl_program program = NULL;
+	cl_int errNo;
+	unsigned int i;
+
+	file = fopen(path, "rb");
+	if(file == NULL) {
+		return NULL;
+	}
+
+	if(   fread(magic, sizeof(magic), 1, file) != 1
+	   || memcmp(magic, PROGRAM_CACHE_MAGIC, sizeof(magic)) != 0
+	   || fread(&key_length, sizeof(key_length), 1, file) != 1
+	   || key_length != strlen(key)) {
+		goto out;
+	}
+
+	stored_key = malloc(key_length);
+	if(   fread(stored_key, key_length, 1, file) != 1
+	   || memcmp(stored_key, key, key_length) != 0
+	   || fread(&num_devices, sizeof(num_devices), 1, file) != 1
+	   || num_devices != context->num_devices) {
+		goto out;
+	}
+
+	lengths = calloc(context->num_devices, sizeof(size_t));
+	binaries = calloc(context->num_devices, sizeof(unsigned char*));
+	for(i = 0; i < context->num_devices; i++) {
+		uint64_t length;
+
+		if(fread(&length, sizeof(length), 1, file) != 1 || length == 0) {
+			goto out;
+		}
+		lengths[i] = length;
+		binaries[i] = malloc(length);
+		if(fread(binaries[i], length, 1, file) != 1) {
+			goto out;
+		}
+	}
+
+	/*
+	 * Not through piglit_cl_build_program_with_binary(), which reports
+	 * a rejected binary as an error.  Here it only misses the cache.
+	 */
+	program = clCreateProgramWithBinary(context->cl_ctx,
+	                                    context->num_devices,
+	                                    context->device_ids,
+	                                    lengths,
+	                                    (const unsigned char**)binaries,
+	                                    NULL,
+	                                    &errNo);
+	if(errNo != CL_SUCCESS) {
+		program = NULL;
+	} else if(clBuildProgram(program,
+	                         context->num_devices,
+	                         context->device_ids,
+	                         options,
+	                         NULL,
+	                         NULL) != CL_SUCCESS) {
+		clReleaseProgram(program);
+		program = NULL;
+	}
+
+out:
+	if(binaries != NULL) {
+		for(i = 0; i < context->num_devices; i++) {
+			free(binaries[i]);
+		}
+	}
+	free(binaries);
+	free(lengths);
+	free(stored_key);
+	fclose(file);
+
+	return program;
+}
+
+static void
+program_cache_store(piglit_cl_context context, cl_program program,
+                    const char* path, const char* key)
+{
+	size_t* lengths;
+	unsigned char** binaries;
+	char* tmp_path;
+	size_t tmp_path_size;
+	FILE* file;
+	uint64_t value;
+	bool ok = true;
+	unsigned int i;
+
+	lengths = piglit_cl_get_program_info(program, CL_PROGRAM_BINARY_SIZES);
+	if(lengths == NULL) {
+		return;
+	}
+
+	binaries = calloc(context->num_devices, sizeof(unsigned char*));
+	for(i = 0; i < context->num_devices; i++) {
+		if(lengths[i] == 0) {
+			ok = false;
+			break;
+		}
+		binaries[i] = malloc(lengths[i]);
+	}
+	ok = ok && clGetProgramInfo(program, CL_PROGRAM_BINARIES,
+	                            context->num_devices * sizeof(unsigned char*),
+	                            binaries, NULL) == CL_SUCCESS;
+
+	/*
+	 * Write to a file of our own and rename it into place, so concurrent
+	 * tests never see a partly written entry.
+	 */
+	tmp_path_size = strlen(path) + 32;
+	tmp_path = malloc(tmp_path_size);
+	snprintf(tmp_path, tmp_path_size, "%s.%lu.tmp",
+	         path, (unsigned long)getpid());
+
+	file = ok ? fopen(tmp_path, "wb") : NULL;
+	if(file != NULL) {
+		value = strlen(key);
+		ok =    fwrite(PROGRAM_CACHE_MAGIC,
+		               sizeof(PROGRAM_CACHE_MAGIC) - 1, 1, file) == 1
+		     && fwrite(&value, sizeof(value), 1, file) == 1
+		     && fwrite(key, strlen(key), 1, file) == 1;
+		value = context->num_devices;
+		ok = ok && fwrite(&value, sizeof(value), 1, file) == 1;
+		for(i = 0; ok && i < context->num_devices; i++) {
+			value = lengths[i];
+			ok =    fwrite(&value, sizeof(value), 1, file) == 1
+			     && fwrite(binaries[i], lengths[i], 1, file) == 1;
+		}
+		ok = fclose(file) == 0 && ok;
+
+		/* A cache that can't be written only costs compile time. */
+		if(!ok || rename(tmp_path, path) != 0) {
+			remove(tmp_path);
+		}
+	}
+
+	for(i = 0; i < context->num_devices; i++) {
+		free(binaries[i]);
+	}
+	free(binaries);
+	free(lengths);
+	free(tmp_path);
+}
+
 cl_program
 piglit_cl_build_program_with_source_extended(piglit_cl_context context,
                                              cl_uint count, char** strings,
@@ -749,6 +1057,23 @@ piglit_cl_build_program_with_source_extended(piglit_cl_context context,
 {
 	cl_int errNo;
 	cl_program program;
+	const char* cache_dir = fail ? NULL : getenv("PIGLIT_CL_PROGRAM_CACHE");
+	char* cache_key = NULL;
+	char* cache_path = NULL;
+
+	if(   cache_dir != NULL && cache_dir[0] != '\0'
+	   && program_cacheable(count, strings, options)) {
+		cache_key = program_cache_key(context, count, strings, options);
+		cache_path = program_cache_path(cache_dir, cache_key);
+
+		program = program_cache_load(context, cache_path, cache_key,
+		                             options);
+		if(program != NULL) {
+			free(cache_key);
+			free(cache_path);
+			return program;
+		}
+	}
 
 	program = clCreateProgramWithSource(context->cl_ctx,
 	                                    count,
@@ -759,6 +1084,8 @@ piglit_cl_build_program_with_source_extended(piglit_cl_context context,
 		fprintf(stderr,
 		        "Could not create program with source: %s\n",
 		        piglit_cl_get_error_name(errNo));
+		free(cache_key);
+		free(cache_path);
 		return NULL;
 	}
 	
@@ -798,9 +1125,17 @@ piglit_cl_build_program_with_source_extended(piglit_cl_context context,
 		}
 
 		clReleaseProgram(program);
+		free(cache_key);
+		free(cache_path);
 		return NULL;
 	}
 
+	if(cache_path != NULL) {
+		program_cache_store(context, program, cache_path, cache_key);
+		free(cache_key);
+		free(cache_path);
+	}
+
 	return program;
 }
 
@@ -1004,6 +1339,43 @@ piglit_cl_read_whole_buffer(cl_command_queue command_queue, cl_mem buffer,
 	return success;
 }
 
+bool
+piglit_cl_enqueue_write_buffer(cl_command_queue command_queue, cl_mem buffer,
+                               size_t offset, size_t cb, const void *ptr)
+{
+	cl_int errNo;
+
+	errNo = clEnqueueWriteBuffer(command_queue, buffer, CL_FALSE, offset, cb,
+	                             ptr, 0, NULL, NULL);
+	if(!piglit_cl_check_error(errNo, CL_SUCCESS)) {
+		fprintf(stderr,
+		        "Could not enqueue buffer write: %s\n",
+		        piglit_cl_get_error_name(errNo));
+		return false;
+	}
+
+	return true;
+}
+
+bool
+piglit_cl_enqueue_read_buffer(cl_command_queue command_queue, cl_mem buffer,
+                              size_t offset, size_t cb, void *ptr,
+                              cl_event *event)
+{
+	cl_int errNo;
+
+	errNo = clEnqueueReadBuffer(command_queue, buffer, CL_FALSE, offset, cb,
+	                            ptr, 0, NULL, event);
+	if(!piglit_cl_check_error(errNo, CL_SUCCESS)) {
+		fprintf(stderr,
+		        "Could not enqueue buffer read: %s\n",
+		        piglit_cl_get_error_name(errNo));
+		return false;
+	}
+
+	return true;
+}
+
 cl_kernel
 piglit_cl_create_kernel(cl_program program, const char* kernel_name)
 {
@@ -528,6 +528,47 @@ piglit_cl_read_whole_buffer(cl_command_queue command_queue,
                             cl_mem buffer,
                             void *ptr);
 
+/**
+ * \brief Non-blocking write to a buffer.
+ *
+ * The data at \c ptr must not change until the write has completed.
+ *
+ * @param command_queue  Command queue to enqueue operation on.
+ * @param buffer         Memory buffer to write to.
+ * @param offset         Offset in buffer.
+ * @param cb             Size of data in bytes.
+ * @param ptr            Pointer to data to be written to buffer.
+ * @return               \c true on succes, \c false otherwise.
+ */
+bool
+piglit_cl_enqueue_write_buffer(cl_command_queue command_queue,
+                               cl_mem buffer,
+                               size_t offset,
+                               size_t cb,
+                               const void *ptr);
+
+/**
+ * \brief Non-blocking read from a buffer.
+ *
+ * The data at \c ptr is valid once \c event has completed.
+ *
+ * @param command_queue  Command queue to enqueue operation on.
+ * @param buffer         Memory buffer to read from.
+ * @param offset         Offset in buffer.
+ * @param cb             Size of data in bytes.
+ * @param ptr            Pointer to data to be written from buffer.
+ * @param event          Returns the event of the read.  It must be
+ *                       released by the caller.
+ * @return               \c true on succes, \c false otherwise.
+ */
+bool
+piglit_cl_enqueue_read_buffer(cl_command_queue command_queue,
+                              cl_mem buffer,
+                              size_t offset,
+                              size_t cb,
+                              void *ptr,
+                              cl_event *event);
+
 /**
  * \brief Create a kernel.
  *
@@ -79,10 +79,25 @@ piglit_check_egl_error(EGLint expected_error)
 bool
 piglit_is_egl_extension_supported(EGLDisplay egl_dpy, const char *name)
 {
+	/* Extension set of the display that was queried last. */
+	static EGLDisplay cached_dpy = EGL_NO_DISPLAY;
+	static const char *cached_list = NULL;
+	static struct piglit_extension_set *cached_set = NULL;
+
 	const char *const egl_extension_list =
 		eglQueryString(egl_dpy, EGL_EXTENSIONS);
 
-	return piglit_is_extension_in_string(egl_extension_list, name);
+	if (egl_extension_list == NULL)
+		return false;
+
+	if (egl_dpy != cached_dpy || egl_extension_list != cached_list) {
+		piglit_extension_set_destroy(cached_set);
+		cached_set = piglit_extension_set_create(egl_extension_list);
+		cached_dpy = egl_dpy;
+		cached_list = egl_extension_list;
+	}
+
+	return piglit_extension_set_contains(cached_set, name);
 }
 
 void piglit_require_egl_extension(const char *name)
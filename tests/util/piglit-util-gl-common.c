@@ -26,13 +26,9 @@
 
 
 /**
- * An array of pointers to extension strings.
- *
- * Each extension is pointed to by a separate entry in the array.
- *
- * The end of the array is indicated by a NULL pointer.
+ * The set of extensions supported by the current context.
  */
-static const char **gl_extensions = NULL;
+static struct piglit_extension_set *gl_extensions = NULL;
 
 bool piglit_is_core_profile;
 
@@ -63,37 +59,17 @@ int piglit_get_gl_version(void)
 	return 10*major+minor;
 }
 
-static const char** split_string(const char *string)
-{
-	char **strings, *string_copy;
-	int i, length, max_words;
-
-	length = strlen(string);
-	max_words = length / 2;
-	strings = malloc ((sizeof(char*) * (max_words + 1)) +
-	                  (sizeof(char) * (length + 1)));
-	assert (strings != NULL);
-
-	string_copy = (char*) &strings[max_words + 1];
-	strcpy(string_copy, string);
-
-	strings[0] = strtok(string_copy, " ");
-	for (i = 0; strings[i] != NULL; ++i)
-		strings[i + 1] = strtok(NULL, " ");
-
-	return (const char**) strings;
-}
-
-static const char** gl_extension_array_from_getstring()
+static struct piglit_extension_set *gl_extension_set_from_getstring()
 {
 	const char *gl_extensions_string;
 	gl_extensions_string = (const char *) glGetString(GL_EXTENSIONS);
-	return split_string(gl_extensions_string);
+	return piglit_extension_set_create(gl_extensions_string);
 }
 
 #if defined(PIGLIT_USE_OPENGL)
-static const char** gl_extension_array_from_getstringi()
+static struct piglit_extension_set *gl_extension_set_from_getstringi()
 {
+	struct piglit_extension_set *set;
 	const char **strings;
 	int loop, num_extensions;
 
@@ -107,7 +83,10 @@ static const char** gl_extension_array_from_getstringi()
 
 	strings[loop] = NULL;
 
-	return (const char**) strings;
+	set = piglit_extension_set_create_from_array(strings);
+	free(strings);
+
+	return set;
 }
 #endif
 
@@ -120,12 +99,12 @@ static void initialize_piglit_extension_support(void)
 #if defined(PIGLIT_USE_OPENGL_ES1) || \
     defined(PIGLIT_USE_OPENGL_ES2) || \
     defined(PIGLIT_USE_OPENGL_ES3)
-	gl_extensions = gl_extension_array_from_getstring();
+	gl_extensions = gl_extension_set_from_getstring();
 #elif defined(PIGLIT_USE_OPENGL)
 	if (piglit_get_gl_version() < 30) {
-		gl_extensions = gl_extension_array_from_getstring();
+		gl_extensions = gl_extension_set_from_getstring();
 	} else {
-		gl_extensions = gl_extension_array_from_getstringi();
+		gl_extensions = gl_extension_set_from_getstringi();
 	}
 #else
 #error Need code implemented to read extensions
@@ -135,7 +114,13 @@ static void initialize_piglit_extension_support(void)
 bool piglit_is_extension_supported(const char *name)
 {
 	initialize_piglit_extension_support();
-	return piglit_is_extension_in_array(gl_extensions, name);
+	return piglit_extension_set_contains(gl_extensions, name);
+}
+
+void piglit_print_gl_extensions(void)
+{
+	initialize_piglit_extension_support();
+	piglit_extension_set_print(gl_extensions);
 }
 
 void piglit_require_gl_version(int required_version_times_10)
@@ -441,6 +426,204 @@ piglit_probe_rect_halves_equal_rgba(int x, int y, int w, int h)
 }
 
 
+struct probe_batch_entry {
+	int x, y;
+	int num_components;
+	float expected[4];
+	float tolerance[4];
+};
+
+static struct probe_batch_entry *probe_batch;
+static unsigned probe_batch_len;
+static unsigned probe_batch_size;
+
+static void
+probe_batch_add(int x, int y, int num_components, const float *expected)
+{
+	struct probe_batch_entry *e;
+
+	if (probe_batch_len == probe_batch_size) {
+		probe_batch_size = probe_batch_size ? probe_batch_size * 2 : 16;
+		probe_batch = realloc(probe_batch,
+				      probe_batch_size * sizeof(*probe_batch));
+	}
+
+	e = &probe_batch[probe_batch_len++];
+	e->x = x;
+	e->y = y;
+	e->num_components = num_components;
+	memcpy(e->expected, expected, num_components * sizeof(float));
+	memcpy(e->tolerance, piglit_tolerance, sizeof(e->tolerance));
+}
+
+/**
+ * Queue a probe of the RGB value of the pixel at (x, y).
+ *
+ * Nothing is read from the framebuffer until piglit_probe_batch_flush() is
+ * called.  The current piglit_tolerance is recorded with the probe.
+ */
+void
+piglit_probe_batch_pixel_rgb(int x, int y, const float *expected)
+{
+	probe_batch_add(x, y, 3, expected);
+}
+
+/**
+ * Queue a probe of the RGBA value of the pixel at (x, y).
+ *
+ * \sa piglit_probe_batch_pixel_rgb
+ */
+void
+piglit_probe_batch_pixel_rgba(int x, int y, const float *expected)
+{
+	probe_batch_add(x, y, 4, expected);
+}
+
+/**
+ * Return the number of probes queued since the last flush.
+ */
+unsigned
+piglit_probe_batch_pending(void)
+{
+	return probe_batch_len;
+}
+
+/*
+ * Above this many pixels per probe, the bounding box of a batch is not
+ * read back; reading the probed pixels one at a time is cheaper.
+ */
+#define PROBE_BATCH_MAX_PIXELS_PER_PROBE 256
+#define PROBE_BATCH_MIN_PIXELS (64 * 64)
+
+/*
+ * Read a w x h block of RGBA pixels as floats.
+ */
+static void
+probe_batch_read(int x, int y, int w, int h, float *pixels)
+{
+#if defined(PIGLIT_USE_OPENGL)
+	glReadPixels(x, y, w, h, GL_RGBA, GL_FLOAT, pixels);
+#else
+	/* GLES only guarantees GL_RGBA/GL_UNSIGNED_BYTE reads.  Read them
+	 * into the start of the buffer and widen them back to front, so
+	 * no byte is overwritten before it is converted.
+	 */
+	GLubyte *ubyte_pixels = (GLubyte *) pixels;
+	int i;
+
+	glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, ubyte_pixels);
+	for (i = w * h * 4 - 1; i >= 0; i--)
+		pixels[i] = ubyte_pixels[i] / 255.0;
+#endif
+}
+
+/**
+ * Evaluate all queued probes and empty the queue.
+ *
+ * The bounding box of the queued pixels is read back with a single
+ * glReadPixels, so a test that checks many pixels of the same frame only
+ * waits for the rendering once.  Every failing probe is logged, in the
+ * order it was queued, with the same message as piglit_probe_pixel_rgb()
+ * and piglit_probe_pixel_rgba().
+ *
+ * The box only covers probes inside the window.  Probes outside it, and
+ * all probes if the box is large compared to their number or can't be
+ * allocated, are read one pixel at a time.
+ *
+ * \return true if every queued probe matched.
+ */
+bool
+piglit_probe_batch_flush(void)
+{
+	int x0 = 0, y0 = 0, x1 = -1, y1 = -1;
+	size_t w, h, n = 0;
+	unsigned i;
+	int p;
+	bool pass = true;
+	float *pixels = NULL;
+
+	if (probe_batch_len == 0)
+		return true;
+
+	for (i = 0; i < probe_batch_len; i++) {
+		const struct probe_batch_entry *e = &probe_batch[i];
+
+		if (e->x < 0 || e->x >= piglit_width ||
+		    e->y < 0 || e->y >= piglit_height)
+			continue;
+
+		if (n++ == 0) {
+			x0 = x1 = e->x;
+			y0 = y1 = e->y;
+		} else {
+			x0 = MIN2(x0, e->x);
+			x1 = MAX2(x1, e->x);
+			y0 = MIN2(y0, e->y);
+			y1 = MAX2(y1, e->y);
+		}
+	}
+	w = x1 - x0 + 1;
+	h = y1 - y0 + 1;
+
+	if (n > 0 && (w * h <= PROBE_BATCH_MIN_PIXELS ||
+		      w * h <= n * PROBE_BATCH_MAX_PIXELS_PER_PROBE))
+		pixels = malloc(w * h * 4 * sizeof(float));
+	if (pixels != NULL)
+		probe_batch_read(x0, y0, w, h, pixels);
+
+	for (i = 0; i < probe_batch_len; i++) {
+		const struct probe_batch_entry *e = &probe_batch[i];
+		float single[4];
+		const float *probe;
+		bool match = true;
+
+		if (pixels != NULL &&
+		    e->x >= x0 && e->x <= x1 && e->y >= y0 && e->y <= y1) {
+			probe = &pixels[((e->y - y0) * w + (e->x - x0)) * 4];
+		} else {
+			probe_batch_read(e->x, e->y, 1, 1, single);
+			probe = single;
+		}
+
+		for (p = 0; p < e->num_components; p++) {
+			if (fabs(probe[p] - e->expected[p]) > e->tolerance[p])
+				match = false;
+		}
+
+		if (match)
+			continue;
+
+		pass = false;
+		printf("Probe color at (%i,%i)\n", e->x, e->y);
+		if (e->num_components == 4) {
+			printf("  Expected: %f %f %f %f\n",
+			       e->expected[0], e->expected[1],
+			       e->expected[2], e->expected[3]);
+			printf("  Observed: %f %f %f %f\n",
+			       probe[0], probe[1], probe[2], probe[3]);
+		} else {
+			printf("  Expected: %f %f %f\n",
+			       e->expected[0], e->expected[1], e->expected[2]);
+			printf("  Observed: %f %f %f\n",
+			       probe[0], probe[1], probe[2]);
+		}
+	}
+
+	free(pixels);
+	probe_batch_len = 0;
+	return pass;
+}
+
+/**
+ * Drop all queued probes without reading the framebuffer.
+ */
+void
+piglit_probe_batch_discard(void)
+{
+	probe_batch_len = 0;
+}
+
+
 /**
  * Return block size info for a specific texture compression format.
  * \param  bw returns the block width, in pixels
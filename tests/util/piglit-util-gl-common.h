@@ -63,6 +63,12 @@ int piglit_get_gl_version(void);
  */
 bool piglit_is_extension_supported(const char *name);
 
+/**
+ * Print the extensions supported by the current context to stdout,
+ * separated by spaces.
+ */
+void piglit_print_gl_extensions(void);
+
 /**
  * \brief Convert a GL error to a string.
  *
@@ -147,6 +153,11 @@ int piglit_probe_rect_depth(int x, int y, int w, int h, float expected);
 int piglit_probe_pixel_stencil(int x, int y, unsigned expected);
 int piglit_probe_rect_stencil(int x, int y, int w, int h, unsigned expected);
 int piglit_probe_rect_halves_equal_rgba(int x, int y, int w, int h);
+void piglit_probe_batch_pixel_rgb(int x, int y, const float *expected);
+void piglit_probe_batch_pixel_rgba(int x, int y, const float *expected);
+unsigned piglit_probe_batch_pending(void);
+bool piglit_probe_batch_flush(void);
+void piglit_probe_batch_discard(void);
 
 int piglit_use_fragment_program(void);
 int piglit_use_vertex_program(void);
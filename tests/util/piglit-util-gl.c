@@ -33,6 +33,10 @@
 #include <errno.h>
 #include <sys/stat.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "piglit-util-gl-common.h"
 
 
@@ -64,6 +68,124 @@ piglit_num_components(GLenum base_format)
 	}
 }
 
+/**
+ * Quickly check whether every component of \c num_pixels pixels is within
+ * tolerance of the expected color, using the same test as the rect probes:
+ * a component fails if fabs(observed - expected) >= tolerance.
+ *
+ * If \c expected_per_pixel is false, \c expected is a single pixel that
+ * every pixel is compared to, otherwise it is an image laid out like
+ * \c observed.
+ *
+ * This only tells whether the whole image matched, so that the common case
+ * of a passing probe doesn't go through the per-pixel loops.  Callers use
+ * their own loop to find and report the first mismatch.
+ */
+static bool
+colors_match(const float *observed, const float *expected,
+	     bool expected_per_pixel, int num_pixels, int num_components,
+	     const float *tolerance)
+{
+	/* 12 floats is a whole number of pixels for 1 to 4 components. */
+	float expected_pattern[12], tolerance_pattern[12];
+	int n = num_pixels * num_components;
+	int i = 0, k;
+
+	assert(num_components >= 1 && num_components <= 4);
+
+	for (k = 0; k < 12; k++) {
+		tolerance_pattern[k] = tolerance[k % num_components];
+		if (!expected_per_pixel)
+			expected_pattern[k] = expected[k % num_components];
+	}
+
+#ifdef __SSE2__
+	{
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		__m128 fail = _mm_setzero_ps();
+
+		for (; i + 12 <= n; i += 12) {
+			for (k = 0; k < 12; k += 4) {
+				__m128 o = _mm_loadu_ps(&observed[i + k]);
+				__m128 e = expected_per_pixel ?
+					_mm_loadu_ps(&expected[i + k]) :
+					_mm_loadu_ps(&expected_pattern[k]);
+				__m128 t = _mm_loadu_ps(&tolerance_pattern[k]);
+				__m128 d = _mm_andnot_ps(sign, _mm_sub_ps(o, e));
+
+				/* Like the scalar test, false for NaN. */
+				fail = _mm_or_ps(fail, _mm_cmpge_ps(d, t));
+			}
+		}
+
+		if (_mm_movemask_ps(fail))
+			return false;
+	}
+#endif
+
+	for (; i < n; i++) {
+		float e = expected_per_pixel ?
+			expected[i] : expected_pattern[i % 12];
+
+		if (fabs(observed[i] - e) >= tolerance_pattern[i % 12])
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Like colors_match(), for the RGBA integer probes: check whether every
+ * pixel of \c observed is equal to \c expected.
+ *
+ * This is only equivalent to the tolerance test of those probes when all
+ * the tolerances are in (0, 1], see integer_tolerance_is_exact().
+ */
+static bool
+rgba_integers_equal(const uint32_t *observed, const uint32_t *expected,
+		    int num_pixels)
+{
+	int i = 0, p;
+
+#ifdef __SSE2__
+	{
+		const __m128i e = _mm_loadu_si128((const __m128i *) expected);
+		__m128i equal = _mm_set1_epi32(-1);
+
+		for (; i < num_pixels; i++) {
+			__m128i o =
+				_mm_loadu_si128((const __m128i *) &observed[i * 4]);
+			equal = _mm_and_si128(equal, _mm_cmpeq_epi32(o, e));
+		}
+
+		if (_mm_movemask_epi8(equal) != 0xffff)
+			return false;
+	}
+#endif
+
+	for (; i < num_pixels; i++) {
+		for (p = 0; p < 4; p++) {
+			if (observed[i * 4 + p] != expected[p])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+integer_tolerance_is_exact(void)
+{
+	int p;
+
+	for (p = 0; p < 4; p++) {
+		if (!(piglit_tolerance[p] > 0.0 && piglit_tolerance[p] <= 1.0))
+			return false;
+	}
+
+	return true;
+}
+
 /**
  * Read a pixel from the given location and compare its RGBA value to the
  * given expected values.
@@ -144,6 +266,11 @@ piglit_probe_rect_rgba(int x, int y, int w, int h, const float *expected)
 
 	glReadPixels(x, y, w, h, GL_RGBA, GL_FLOAT, pixels);
 
+	if (colors_match(pixels, expected, false, w*h, 4, piglit_tolerance)) {
+		free(pixels);
+		return 1;
+	}
+
 	for (j = 0; j < h; j++) {
 		for (i = 0; i < w; i++) {
 			probe = &pixels[(j*w+i)*4];
@@ -176,6 +303,13 @@ piglit_probe_rect_rgba_int(int x, int y, int w, int h, const int *expected)
 
 	glReadPixels(x, y, w, h, GL_RGBA_INTEGER, GL_INT, pixels);
 
+	if (integer_tolerance_is_exact() &&
+	    rgba_integers_equal((const uint32_t *) pixels,
+				(const uint32_t *) expected, w*h)) {
+		free(pixels);
+		return 1;
+	}
+
 	for (j = 0; j < h; j++) {
 		for (i = 0; i < w; i++) {
 			probe = &pixels[(j*w+i)*4];
@@ -209,6 +343,12 @@ piglit_probe_rect_rgba_uint(int x, int y, int w, int h,
 
 	glReadPixels(x, y, w, h, GL_RGBA_INTEGER, GL_UNSIGNED_INT, pixels);
 
+	if (integer_tolerance_is_exact() &&
+	    rgba_integers_equal(pixels, expected, w*h)) {
+		free(pixels);
+		return 1;
+	}
+
 	for (j = 0; j < h; j++) {
 		for (i = 0; i < w; i++) {
 			probe = &pixels[(j*w+i)*4];
@@ -274,6 +414,11 @@ piglit_compare_images_color(int x, int y, int w, int h, int num_components,
 			    const float *observed_image)
 {
 	int i, j, p;
+
+	if (colors_match(observed_image, expected_image, true, w*h,
+			 num_components, tolerance))
+		return 1;
+
 	for (j = 0; j < h; j++) {
 		for (i = 0; i < w; i++) {
 			const float *expected =
@@ -439,6 +584,11 @@ piglit_probe_rect_rgb(int x, int y, int w, int h, const float *expected)
 
 	glReadPixels(x, y, w, h, GL_RGB, GL_FLOAT, pixels);
 
+	if (colors_match(pixels, expected, false, w*h, 3, piglit_tolerance)) {
+		free(pixels);
+		return 1;
+	}
+
 	for (j = 0; j < h; j++) {
 		for (i = 0; i < w; i++) {
 			probe = &pixels[(j*w+i)*3];
@@ -471,6 +621,11 @@ piglit_probe_rect_rgb_silent(int x, int y, int w, int h, const float *expected)
 
 	glReadPixels(x, y, w, h, GL_RGB, GL_FLOAT, pixels);
 
+	if (colors_match(pixels, expected, false, w*h, 3, piglit_tolerance)) {
+		free(pixels);
+		return 1;
+	}
+
 	for (j = 0; j < h; j++) {
 		for (i = 0; i < w; i++) {
 			probe = &pixels[(j*w+i)*3];
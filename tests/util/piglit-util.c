@@ -40,6 +40,12 @@
 #define USE_SETRLIMIT
 #endif
 
+#if defined(HAVE_CLOCK_GETTIME) && !defined(_WIN32)
+#include <time.h>
+#elif defined(HAVE_SYS_TIME_H)
+#include <sys/time.h>
+#endif
+
 #if defined(HAVE_FCNTL_H) && defined(HAVE_SYS_STAT_H) && defined(HAVE_SYS_TYPES_H) && defined(HAVE_UNISTD_H) && !defined(_WIN32)
 # include <sys/types.h>
 # include <sys/stat.h>
@@ -145,6 +151,187 @@ bool piglit_is_extension_in_string(const char *haystack, const char *needle)
 	return false;
 }
 
+/**
+ * A set of extension names, stored in an open addressing hash table so that
+ * lookups don't depend on the number of extensions the driver exposes.
+ */
+struct piglit_extension_set {
+	/** Table size minus one; the size is a power of two. */
+	unsigned mask;
+	/** Extension names, NULL for empty slots. */
+	const char **table;
+	/** Copy of all the names, pointed to by \c table. */
+	char *names;
+};
+
+static unsigned
+extension_name_hash(const char *name, unsigned len)
+{
+	/* FNV-1a */
+	unsigned hash = 2166136261u;
+	unsigned i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+
+	return hash;
+}
+
+/**
+ * Return the slot holding the first \c len characters of \c name, or the
+ * empty slot where it would be inserted.
+ */
+static const char **
+extension_set_find(const struct piglit_extension_set *set,
+		   const char *name, unsigned len)
+{
+	unsigned i = extension_name_hash(name, len) & set->mask;
+
+	while (set->table[i] != NULL) {
+		if (strncmp(set->table[i], name, len) == 0 &&
+		    set->table[i][len] == '\0')
+			break;
+		i = (i + 1) & set->mask;
+	}
+
+	return &set->table[i];
+}
+
+static struct piglit_extension_set *
+extension_set_alloc(unsigned count, unsigned names_size)
+{
+	struct piglit_extension_set *set = malloc(sizeof(*set));
+	unsigned size = 16;
+
+	/* Keep the table at most half full. */
+	while (size < 2 * count)
+		size *= 2;
+
+	set->mask = size - 1;
+	set->table = calloc(size, sizeof(*set->table));
+	set->names = malloc(names_size);
+	assert(set->table != NULL && set->names != NULL);
+
+	return set;
+}
+
+/**
+ * Build an extension set from a space separated extension string, such as
+ * the one returned by glGetString(GL_EXTENSIONS).
+ */
+struct piglit_extension_set *
+piglit_extension_set_create(const char *extensions)
+{
+	struct piglit_extension_set *set;
+	const char *s;
+	char *dst;
+	unsigned count = 0;
+
+	for (s = extensions; *s != '\0'; s++) {
+		if (*s != ' ' && (s == extensions || s[-1] == ' '))
+			count++;
+	}
+
+	set = extension_set_alloc(count, strlen(extensions) + 1);
+	dst = set->names;
+
+	for (s = extensions; *s != '\0'; ) {
+		unsigned len = strcspn(s, " ");
+		const char **slot;
+
+		if (len == 0) {
+			s++;
+			continue;
+		}
+
+		slot = extension_set_find(set, s, len);
+		if (*slot == NULL) {
+			memcpy(dst, s, len);
+			dst[len] = '\0';
+			*slot = dst;
+			dst += len + 1;
+		}
+		s += len;
+	}
+
+	return set;
+}
+
+/**
+ * Build an extension set from a NULL terminated array of extension names.
+ */
+struct piglit_extension_set *
+piglit_extension_set_create_from_array(const char **extensions)
+{
+	struct piglit_extension_set *set;
+	unsigned count, names_size = 0;
+	char *dst;
+
+	for (count = 0; extensions[count] != NULL; count++)
+		names_size += strlen(extensions[count]) + 1;
+
+	set = extension_set_alloc(count, names_size);
+	dst = set->names;
+
+	for (count = 0; extensions[count] != NULL; count++) {
+		unsigned len = strlen(extensions[count]);
+		const char **slot;
+
+		if (len == 0)
+			continue;
+
+		slot = extension_set_find(set, extensions[count], len);
+		if (*slot == NULL) {
+			memcpy(dst, extensions[count], len + 1);
+			*slot = dst;
+			dst += len + 1;
+		}
+	}
+
+	return set;
+}
+
+bool
+piglit_extension_set_contains(const struct piglit_extension_set *set,
+			      const char *name)
+{
+	const unsigned len = strlen(name);
+
+	if (len == 0)
+		return false;
+
+	return *extension_set_find(set, name, len) != NULL;
+}
+
+/**
+ * Print the names in the set to stdout, separated by spaces, in no
+ * particular order.
+ */
+void
+piglit_extension_set_print(const struct piglit_extension_set *set)
+{
+	const char *separator = "";
+	unsigned i;
+
+	for (i = 0; i <= set->mask; i++) {
+		if (set->table[i] != NULL) {
+			printf("%s%s", separator, set->table[i]);
+			separator = " ";
+		}
+	}
+}
+
+void
+piglit_extension_set_destroy(struct piglit_extension_set *set)
+{
+	if (set == NULL)
+		return;
+
+	free(set->table);
+	free(set->names);
+	free(set);
+}
+
 /** Returns the line in the program string given the character position. */
 int piglit_find_line(const char *program, int position)
 {
@@ -170,6 +357,14 @@ piglit_result_to_string(enum piglit_result result)
         return "Unknown result";
 }
 
+static void (*report_result_hook)(enum piglit_result result) = NULL;
+
+void
+piglit_set_report_result_hook(void (*hook)(enum piglit_result result))
+{
+	report_result_hook = hook;
+}
+
 void
 piglit_report_result(enum piglit_result result)
 {
@@ -180,6 +375,9 @@ piglit_report_result(enum piglit_result result)
 	printf("PIGLIT: {'result': '%s' }\n", result_str);
 	fflush(stdout);
 
+	if (report_result_hook != NULL)
+		report_result_hook(result);
+
 	switch(result) {
 	case PIGLIT_PASS:
 	case PIGLIT_SKIP:
@@ -206,6 +404,51 @@ piglit_report_subtest_result(enum piglit_result result, const char *format, ...)
 	va_end(ap);
 }
 
+static char **selected_subtests = NULL;
+static unsigned num_selected_subtests = 0;
+static bool list_subtests = false;
+
+void
+piglit_select_subtest(const char *name)
+{
+	selected_subtests = realloc(selected_subtests,
+				    (num_selected_subtests + 1) *
+				    sizeof(*selected_subtests));
+	selected_subtests[num_selected_subtests++] = strdup(name);
+}
+
+void
+piglit_enable_subtest_listing(void)
+{
+	list_subtests = true;
+}
+
+bool
+piglit_should_run_subtest(const char *format, ...)
+{
+	char name[4096];
+	va_list ap;
+	unsigned i;
+
+	if (!list_subtests && num_selected_subtests == 0)
+		return true;
+
+	va_start(ap, format);
+	vsnprintf(name, sizeof(name), format, ap);
+	va_end(ap);
+
+	if (list_subtests) {
+		printf("PIGLIT:list-subtest %s\n", name);
+		return false;
+	}
+
+	for (i = 0; i < num_selected_subtests; i++) {
+		if (strcmp(selected_subtests[i], name) == 0)
+			return true;
+	}
+	return false;
+}
+
 #ifndef HAVE_STRCHRNUL
 char *strchrnul(const char *s, int c)
 {
@@ -245,6 +488,35 @@ piglit_set_rlimit(unsigned long lim)
 #endif
 }
 
+int64_t
+piglit_time_get_nano(void)
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (int64_t) (counter.QuadPart / frequency.QuadPart) * 1000000000 +
+		(int64_t) (counter.QuadPart % frequency.QuadPart) *
+		1000000000 / frequency.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (int64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+#elif defined(HAVE_SYS_TIME_H)
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (int64_t) tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#else
+	return 0;
+#endif
+}
+
 /* Merges the PASS/FAIL/SKIP for @subtest into the overall result
  * @all.
  *
@@ -133,19 +133,75 @@ bool piglit_is_extension_in_string(const char *haystack, const char *needle);
  */
 bool piglit_is_extension_in_array(const char **haystack, const char *needle);
 
+/**
+ * A set of extension names with constant time lookups, for code that checks
+ * the same extension list many times.
+ *
+ * The names are copied, so the string or array the set was created from
+ * doesn't have to outlive it.
+ *
+ * \sa piglit_is_extension_supported, piglit_cl_is_device_extension_supported
+ */
+struct piglit_extension_set;
+
+struct piglit_extension_set *
+piglit_extension_set_create(const char *extensions);
+struct piglit_extension_set *
+piglit_extension_set_create_from_array(const char **extensions);
+bool piglit_extension_set_contains(const struct piglit_extension_set *set,
+				   const char *name);
+void piglit_extension_set_print(const struct piglit_extension_set *set);
+void piglit_extension_set_destroy(struct piglit_extension_set *set);
+
 int piglit_find_line(const char *program, int position);
 void piglit_merge_result(enum piglit_result *all, enum piglit_result subtest);
 const char * piglit_result_to_string(enum piglit_result result);
 void piglit_report_result(enum piglit_result result);
+
+/**
+ * Install a function to be called by piglit_report_result() after the
+ * result has been printed, in place of exiting the process.
+ *
+ * This lets a test binary run several independent tests in one process.
+ * The hook must not return (typically it longjmp()s back to the caller's
+ * test loop); if it does, piglit_report_result() exits as usual.  Pass NULL
+ * to restore the default behavior.
+ */
+void piglit_set_report_result_hook(void (*hook)(enum piglit_result result));
 void piglit_report_subtest_result(enum piglit_result result,
 				  const char *format, ...) PRINTFLIKE(2, 3);
 
+/**
+ * Subtest enumeration and selection, so that the runner can split a test
+ * with many subtests over several processes.
+ *
+ * A test that supports it calls piglit_should_run_subtest(), with the
+ * same name it will pass to piglit_report_subtest_result(), before
+ * running each subtest, and skips the subtest if it returns false.
+ *
+ * With -list-subtests, every subtest is skipped and its name printed on
+ * a "PIGLIT:list-subtest <name>" line instead.  With one or more
+ * "-subtest <name>" options, only the named subtests run.  Otherwise
+ * they all do.
+ */
+void piglit_select_subtest(const char *name);
+void piglit_enable_subtest_listing(void);
+bool piglit_should_run_subtest(const char *format, ...) PRINTFLIKE(1, 2);
+
 #ifndef HAVE_STRCHRNUL
 char *strchrnul(const char *s, int c);
 #endif
 
 extern void piglit_set_rlimit(unsigned long lim);
 
+/**
+ * Return the current time in nanoseconds, for measuring intervals.
+ *
+ * The clock is monotonic where the platform provides one.  Its origin is
+ * arbitrary.
+ */
+int64_t piglit_time_get_nano(void);
+
 char *piglit_load_text_file(const char *file_name, unsigned *size);
 
 /**
@@ -50,7 +50,27 @@
  * value is the number of rows of vertex data found.
  *
  * If an error occurs, setup_vbo_from_text() will print out a
- * description of the error and exit with PIGLIT_FAIL.
+ * description of the error and return PIGLIT_VBO_ERROR, for the caller
+ * to report.
+ *
+ * Large vertex data can instead be stored in a binary file, which is
+ * loaded with setup_vbo_from_file() without parsing any numbers.  The
+ * file consists of three text lines followed by the data:
+ *
+ *   \verbatim
+ *   piglit vbo 1
+ *   vertex/float/3 foo/uint/1 bar/int/2
+ *   3
+ *   \endverbatim
+ *
+ * The first line identifies the format, the second holds the column
+ * headers, exactly as in the text format, and the third the number of
+ * rows.  The rows follow right after the newline ending the third line,
+ * as packed little-endian values laid out like vertex_data[] below.
+ * They are handed to GL as they are on little-endian hosts, and
+ * byte-swapped first on big-endian ones.
+ * tests/util/piglit_vbo_binary.py converts the text format into this
+ * one.
  *
  * For the example above, the call to setup_vbo_from_text() is roughly
  * equivalent to the following GL operations:
@@ -86,6 +106,7 @@
  * \endcode
  */
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <errno.h>
@@ -94,6 +115,15 @@
 #include "piglit-util-gl-common.h"
 #include "piglit-vbo.h"
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_FCNTL_H) && \
+    defined(HAVE_SYS_STAT_H) && defined(HAVE_UNISTD_H)
+#define USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /**
  * Currently all the attribute types we support (int, uint, and float)
  * are 4 bytes in width.
@@ -101,6 +131,17 @@
 const int ATTRIBUTE_SIZE = 4;
 
 
+/**
+ * Thrown, after printing a description of the problem, when the vertex
+ * data is invalid.  It is caught in the C entry points, so no C++ frames
+ * are unwound by piglit_report_result(), which may longjmp() in batch
+ * mode.
+ */
+class vbo_error
+{
+};
+
+
 /**
  * Convert a type name string to a GLenum.
  */
@@ -124,8 +165,7 @@ decode_type(const char *type)
 	}
 
 	printf("Unrecognized type: %s\n", type);
-	piglit_report_result(PIGLIT_FAIL);
-	return 0;
+	throw vbo_error();
 }
 
 
@@ -162,7 +202,7 @@ public:
  * type and count parts of the header.
  *
  * If there is a parse failure, print a description of the problem and
- * then exit with PIGLIT_FAIL.
+ * then throw vbo_error.
  */
 vertex_attrib_description::vertex_attrib_description(GLuint prog,
 						     const char *text)
@@ -173,7 +213,7 @@ vertex_attrib_description::vertex_attrib_description(GLuint prog,
 		printf("Column headers must be in the form name/type/count.  "
 		       "Got: %s\n",
 		       text);
-		piglit_report_result(PIGLIT_FAIL);
+		throw vbo_error();
 	}
 	std::string name(text, first_slash);
 	const char *second_slash = strchr(first_slash + 1, '/');
@@ -181,7 +221,7 @@ vertex_attrib_description::vertex_attrib_description(GLuint prog,
 		printf("Column headers must be in the form name/type/count.  "
 		       "Got: %s\n",
 		       text);
-		piglit_report_result(PIGLIT_FAIL);
+		throw vbo_error();
 	}
 	std::string type_str(first_slash + 1, second_slash);
 	this->data_type = decode_type(type_str.c_str());
@@ -191,13 +231,13 @@ vertex_attrib_description::vertex_attrib_description(GLuint prog,
 		printf("Column headers must be in the form name/type/count.  "
 		       "Got: %s\n",
 		       text);
-		piglit_report_result(PIGLIT_FAIL);
+		throw vbo_error();
 	}
 
 	GLint attrib_location = glGetAttribLocation(prog, name.c_str());
 	if (attrib_location == -1) {
 		printf("Unexpected vbo column name.  Got: %s\n", name.c_str());
-		piglit_report_result(PIGLIT_FAIL);
+		throw vbo_error();
 	}
 	this->index = attrib_location;
 	/* If the type is integral, verify that integer vertex
@@ -213,12 +253,12 @@ vertex_attrib_description::vertex_attrib_description(GLuint prog,
 		!piglit_is_extension_supported("GL_EXT_gpu_shader4")))) {
 		printf("Test uses glVertexAttribIPointer(),"
 		       " which is unsupported.\n");
-		piglit_report_result(PIGLIT_FAIL);
+		throw vbo_error();
 	}
 
 	if (this->count < 1 || this->count > 4) {
 		printf("Count must be between 1 and 4.  Got: %lu\n", (unsigned long) count);
-		piglit_report_result(PIGLIT_FAIL);
+		throw vbo_error();
 	}
 }
 
@@ -307,7 +347,10 @@ class vbo_data
 {
 public:
 	vbo_data(std::string const &text, GLuint prog);
+	vbo_data(const std::string &header_line, size_t num_rows,
+		 GLuint prog);
 	size_t setup() const;
+	size_t setup(const void *data, size_t size) const;
 
 private:
 	void parse_header_line(const std::string &line, GLuint prog);
@@ -358,7 +401,7 @@ is_blank_line(const std::string &line)
  * headers.
  *
  * If there is a parse failure, print a description of the problem and
- * then exit with PIGLIT_FAIL.
+ * then throw vbo_error.
  */
 void
 vbo_data::parse_header_line(const std::string &line, GLuint prog)
@@ -389,7 +432,7 @@ vbo_data::parse_header_line(const std::string &line, GLuint prog)
  * Convert a data row into binary form and append it to this->raw_data.
  *
  * If there is a parse failure, print a description of the problem and
- * then exit with PIGLIT_FAIL.
+ * then throw vbo_error.
  */
 void
 vbo_data::parse_data_line(const std::string &line, unsigned int line_num)
@@ -407,7 +450,7 @@ vbo_data::parse_data_line(const std::string &line, unsigned int line_num)
 				printf("At line %u of [vertex data] section\n",
 				       line_num);
 				printf("Offending text: %s\n", line_ptr);
-				piglit_report_result(PIGLIT_FAIL);
+				throw vbo_error();
 			}
 			data_ptr += ATTRIBUTE_SIZE;
 		}
@@ -421,7 +464,7 @@ vbo_data::parse_data_line(const std::string &line, unsigned int line_num)
  * Parse a line of input text.
  *
  * If there is a parse failure, print a description of the problem and
- * then exit with PIGLIT_FAIL.
+ * then throw vbo_error.
  */
 void
 vbo_data::parse_line(std::string line, unsigned int line_num, GLuint prog)
@@ -446,7 +489,7 @@ vbo_data::parse_line(std::string line, unsigned int line_num, GLuint prog)
  * Parse the input but don't execute any GL commands.
  *
  * If there is a parse failure, print a description of the problem and
- * then exit with PIGLIT_FAIL.
+ * then throw vbo_error.
  */
 vbo_data::vbo_data(const std::string &text, GLuint prog)
 	: header_seen(false), stride(0), num_rows(0)
@@ -458,12 +501,28 @@ vbo_data::vbo_data(const std::string &text, GLuint prog)
 		size_t end_of_line = text.find('\n', pos);
 		if (end_of_line == std::string::npos)
 			end_of_line = text.size();
-		parse_line(text.substr(pos, end_of_line), line_num++, prog);
+		parse_line(text.substr(pos, end_of_line - pos), line_num++,
+			   prog);
 		pos = end_of_line + 1;
 	}
 }
 
 
+/**
+ * Describe binary vertex data, with the given column headers and
+ * number of rows, that is passed to setup(data, size) later.
+ *
+ * If there is a parse failure, print a description of the problem and
+ * then throw vbo_error.
+ */
+vbo_data::vbo_data(const std::string &header_line, size_t num_rows,
+		   GLuint prog)
+	: header_seen(true), stride(0), num_rows(num_rows)
+{
+	parse_header_line(header_line, prog);
+}
+
+
 /**
  * Execute the necessary GL commands to set up the vertex data passed
  * to the constructor.
@@ -471,11 +530,28 @@ vbo_data::vbo_data(const std::string &text, GLuint prog)
 size_t
 vbo_data::setup() const
 {
+	return setup(&this->raw_data[0], this->raw_data.size());
+}
+
+
+/**
+ * Execute the necessary GL commands to set up the vertex data \c data,
+ * which holds \c size bytes laid out as described by the column headers.
+ */
+size_t
+vbo_data::setup(const void *data, size_t size) const
+{
+	if (size != this->stride * this->num_rows) {
+		printf("Vertex data is %lu bytes, expected %lu rows of %lu\n",
+		       (unsigned long) size, (unsigned long) this->num_rows,
+		       (unsigned long) this->stride);
+		throw vbo_error();
+	}
+
 	GLuint buffer_handle;
 	glGenBuffers(1, &buffer_handle);
 	glBindBuffer(GL_ARRAY_BUFFER, buffer_handle);
-	glBufferData(GL_ARRAY_BUFFER, this->stride * this->num_rows,
-		     &this->raw_data[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
 
 	size_t offset = 0;
 	for (size_t i = 0; i < attribs.size(); ++i)
@@ -492,7 +568,8 @@ vbo_data::setup() const
  * data encoded in text_start.  text_end indicates the end of the text
  * string; if it is NULL, the string is assumed to be null-terminated.
  *
- * Return value is the number of rows of vertex data found.
+ * Return value is the number of rows of vertex data found, or
+ * PIGLIT_VBO_ERROR if the data is invalid.
  *
  * For details about the format of the text string, see the comment at
  * the top of this file.
@@ -502,6 +579,140 @@ setup_vbo_from_text(GLuint prog, const char *text_start, const char *text_end)
 {
 	if (text_end == NULL)
 		text_end = text_start + strlen(text_start);
-	std::string text(text_start, text_end);
-	return vbo_data(text, prog).setup();
+	try {
+		std::string text(text_start, text_end);
+		return vbo_data(text, prog).setup();
+	} catch (const vbo_error &) {
+		return PIGLIT_VBO_ERROR;
+	}
+}
+
+
+/**
+ * Set up a vertex buffer object for the program prog from \c size bytes
+ * of binary vertex data file \c contents, read from \c filename.
+ */
+static size_t
+setup_vbo_from_contents(GLuint prog, const char *filename,
+			const char *contents, size_t size)
+{
+	static const char magic[] = "piglit vbo 1\n";
+
+	/* Split off the three header lines. */
+	const char *lines[4];
+	lines[0] = contents;
+	for (int i = 1; i < 4; i++) {
+		const char *end = (const char *)
+			memchr(lines[i - 1], '\n',
+			       contents + size - lines[i - 1]);
+		if (end == NULL) {
+			printf("Truncated vertex data file \"%s\"\n",
+			       filename);
+			throw vbo_error();
+		}
+		lines[i] = end + 1;
+	}
+
+	if (size_t(lines[1] - lines[0]) != strlen(magic) ||
+	    memcmp(lines[0], magic, strlen(magic)) != 0) {
+		printf("\"%s\" is not a piglit vbo file\n", filename);
+		throw vbo_error();
+	}
+
+	std::string header(lines[1], lines[2] - 1);
+	std::string rows(lines[2], lines[3] - 1);
+	char *endptr;
+	size_t num_rows = strtoul(rows.c_str(), &endptr, 10);
+	if (rows.empty() || *endptr != '\0') {
+		printf("Bad row count in vertex data file \"%s\": %s\n",
+		       filename, rows.c_str());
+		throw vbo_error();
+	}
+
+	vbo_data vbo(header, num_rows, prog);
+	const char *data = lines[3];
+	size_t data_size = contents + size - lines[3];
+
+	/* The values are stored little-endian, and all ATTRIBUTE_SIZE
+	 * bytes wide, so a big-endian host swaps the bytes of each.
+	 */
+	const unsigned one = 1;
+	std::vector<char> swapped;
+	if (*(const unsigned char *) &one == 0 && data_size > 0) {
+		swapped.assign(data, data + data_size);
+		for (size_t i = 0; i + ATTRIBUTE_SIZE <= data_size;
+		     i += ATTRIBUTE_SIZE)
+			std::reverse(&swapped[i], &swapped[i] + ATTRIBUTE_SIZE);
+		data = &swapped[0];
+	}
+
+	return vbo.setup(data, data_size);
+}
+
+
+/**
+ * Set up a vertex buffer object for the program prog from the binary
+ * vertex data file \c filename.  The data is handed to glBufferData
+ * straight from the (memory mapped, where possible) file.
+ *
+ * Return value is the number of rows of vertex data found, or
+ * PIGLIT_VBO_ERROR if the file is invalid.
+ *
+ * For details about the file format, see the comment at the top of
+ * this file.
+ */
+size_t
+setup_vbo_from_file(GLuint prog, const char *filename)
+{
+	size_t num_rows;
+
+#ifdef USE_MMAP
+	struct stat st;
+	int fd = open(filename, O_RDONLY);
+	void *map = MAP_FAILED;
+
+	if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (fd >= 0)
+		close(fd);
+	if (map == MAP_FAILED) {
+		printf("Could not map vertex data file \"%s\"\n", filename);
+		return PIGLIT_VBO_ERROR;
+	}
+
+	try {
+		num_rows = setup_vbo_from_contents(prog, filename,
+						   (const char *) map,
+						   st.st_size);
+	} catch (const vbo_error &) {
+		num_rows = PIGLIT_VBO_ERROR;
+	}
+
+	munmap(map, st.st_size);
+#else
+	try {
+		std::vector<char> buffer;
+		FILE *f = fopen(filename, "rb");
+
+		if (f != NULL) {
+			char chunk[65536];
+			size_t n;
+
+			while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+				buffer.insert(buffer.end(), chunk, chunk + n);
+			fclose(f);
+		}
+		if (buffer.empty()) {
+			printf("Could not read vertex data file \"%s\"\n",
+			       filename);
+			throw vbo_error();
+		}
+		num_rows = setup_vbo_from_contents(prog, filename,
+						   &buffer[0], buffer.size());
+	} catch (const vbo_error &) {
+		num_rows = PIGLIT_VBO_ERROR;
+	}
+#endif
+
+	return num_rows;
 }
@@ -27,9 +27,18 @@
 extern "C" {
 #endif
 
+/**
+ * Returned by setup_vbo_from_text() and setup_vbo_from_file() if the
+ * vertex data is invalid.
+ */
+#define PIGLIT_VBO_ERROR ((size_t) -1)
+
 size_t
 setup_vbo_from_text(GLuint prog, const char *text_start, const char *text_end);
 
+size_t
+setup_vbo_from_file(GLuint prog, const char *filename);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
@@ -26,8 +26,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "config.h"
 #include "piglit_ktx.h"
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_UNISTD_H)
+#define USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 /* FIXME: Remove #defines when piglit-dispatch gains support for GLES. */
 #define GL_TEXTURE_1D				0x0DE0
 #define GL_TEXTURE_1D_ARRAY			0x8C18
@@ -45,6 +52,9 @@
 #define GL_TEXTURE_BINDING_CUBE_MAP		0x8514
 #define GL_TEXTURE_BINDING_CUBE_MAP_ARRAY	0x900A
 
+#define GL_PIXEL_UNPACK_BUFFER			0x88EC
+#define GL_PIXEL_UNPACK_BUFFER_BINDING		0x88EF
+
 static const int piglit_ktx_header_length = 64;
 static const char piglit_ktx_magic_number[12] =
 	{ 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
@@ -67,6 +77,19 @@ struct piglit_ktx {
 	/** \brief The raw KTX data. */
 	void *data;
 
+	/**
+	 * \brief Length of the mapping of the file, if \a data is one.
+	 *
+	 * Zero if \a data was allocated with malloc().
+	 */
+	size_t mapped_size;
+
+	/**
+	 * \brief True while the images are uploaded from a pixel unpack
+	 * buffer holding \a data.
+	 */
+	bool use_pbo;
+
 	/**
 	 * \brief Array of images.
 	 *
@@ -98,6 +121,11 @@ piglit_ktx_destroy(struct piglit_ktx *self)
 	if (self->images != NULL)
 		free(self->images);
 
+#ifdef USE_MMAP
+	if (self->mapped_size != 0)
+		munmap(self->data, self->mapped_size);
+	else
+#endif
 	if (self->data)
 		free(self->data);
 
@@ -330,13 +358,13 @@ piglit_ktx_parse_images(struct piglit_ktx *self)
 	for (miplevel = 0; miplevel < info->num_miplevels; ++miplevel) {
 		uint32_t image_size;
 
-		if (info->size < CUR_SIZE + 1) {
+		if (info->size < CUR_SIZE + 4) {
 			/*
 			 * Reading the image size below would access
 			 * out-of-bounds memory.
 			 */
 			piglit_ktx_error("size of data stream must be at "
-					 "least %u", CUR_SIZE + 1);
+					 "least %u", CUR_SIZE + 4);
 			return false;
 		}
 
@@ -448,17 +476,31 @@ piglit_ktx_read_file(const char *filename)
 	if (error)
 		goto bad_read;
 
-	self->data = malloc(self->info.size);
-	if (self->data == NULL)
-		goto out_of_memory;
-
+#ifdef USE_MMAP
 	/*
-	 * On Unix, one should mmap() here rather than copy. But this code
-	 * needs to support Windows too.
+	 * Map the file rather than copy it, so that the images are uploaded
+	 * straight from the page cache. Fall back to reading the file if it
+	 * can't be mapped, for example because it is empty.
 	 */
-	size_read = fread(self->data, 1, self->info.size, file);
-	if (size_read < self->info.size)
-		goto bad_read;
+	if (self->info.size > 0) {
+		void *map = mmap(NULL, self->info.size, PROT_READ, MAP_PRIVATE,
+				 fileno(file), 0);
+		if (map != MAP_FAILED) {
+			self->data = map;
+			self->mapped_size = self->info.size;
+		}
+	}
+#endif
+
+	if (self->data == NULL) {
+		self->data = malloc(self->info.size);
+		if (self->data == NULL)
+			goto out_of_memory;
+
+		size_read = fread(self->data, 1, self->info.size, file);
+		if (size_read < self->info.size)
+			goto bad_read;
+	}
 
 	ok = piglit_ktx_parse_data(self);
 	goto end;
@@ -585,6 +627,23 @@ piglit_ktx_get_image(struct piglit_ktx *self,
 		return &self->images[miplevel];
 }
 
+/**
+ * \brief The pixels argument of glTexImage() for an image.
+ *
+ * While the images are uploaded from a pixel unpack buffer, this is the
+ * offset of the image in the buffer rather than a pointer.
+ */
+static const void *
+piglit_ktx_image_pixels(struct piglit_ktx *self,
+			const struct piglit_ktx_image *img)
+{
+	if (!self->use_pbo)
+		return img->data;
+
+	return (const void *) ((const uint8_t *) img->data -
+			       (const uint8_t *) self->data);
+}
+
 static bool
 piglit_ktx_load_cubeface(struct piglit_ktx *self,
                          int image,
@@ -592,6 +651,7 @@ piglit_ktx_load_cubeface(struct piglit_ktx *self,
 {
 	const struct piglit_ktx_info *info = &self->info;
 	const struct piglit_ktx_image *img = &self->images[image];
+	const void *pixels = piglit_ktx_image_pixels(self, img);
 
 	GLenum face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + (image % 6);
 	int level = image / 6;
@@ -604,7 +664,7 @@ piglit_ktx_load_cubeface(struct piglit_ktx *self,
 				       img->pixel_height,
 				       0 /*border*/,
 				       img->size,
-				       img->data);
+				       pixels);
 	else
 		glTexImage2D(face,
 			     level,
@@ -614,7 +674,7 @@ piglit_ktx_load_cubeface(struct piglit_ktx *self,
 			     0 /*border*/,
 			     info->gl_format,
 			     info->gl_type,
-			     img->data);
+			     pixels);
 
 	*gl_error = glGetError();
 	return *gl_error == 0;
@@ -627,6 +687,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 {
 	const struct piglit_ktx_info *info = &self->info;
 	const struct piglit_ktx_image *img = &self->images[image];
+	const void *pixels = piglit_ktx_image_pixels(self, img);
 	int level = image;
 
 	switch (info->target) {
@@ -639,7 +700,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 					       img->pixel_width,
 					       0 /*border*/,
 					       img->size,
-					       img->data);
+					       pixels);
 		else
 			glTexImage1D(info->target,
 				     level,
@@ -648,7 +709,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 				     0 /*border*/,
 				     info->gl_format,
 				     info->gl_type,
-				     img->data);
+				     pixels);
 		break;
 #else
 		goto unsupported_on_gles;
@@ -664,7 +725,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 					       img->pixel_height,
 					       0 /*border*/,
 					       img->size,
-					       img->data);
+					       pixels);
 		else
 			glTexImage2D(info->target,
 				     level,
@@ -674,7 +735,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 				     0 /*border*/,
 				     info->gl_format,
 				     info->gl_type,
-				     img->data);
+				     pixels);
 		break;
 	case GL_TEXTURE_2D_ARRAY:
 	case GL_TEXTURE_3D:
@@ -689,7 +750,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 					       img->pixel_depth,
 					       0 /*border*/,
 					       img->size,
-					       img->data);
+					       pixels);
 		else
 			glTexImage3D(info->target,
 				     level,
@@ -700,7 +761,7 @@ piglit_ktx_load_noncubeface(struct piglit_ktx *self,
 				     0 /*border*/,
 				     info->gl_format,
 				     info->gl_type,
-				     img->data);
+				     pixels);
 		break;
 #else
 		goto unsupported_on_gles;
@@ -762,10 +823,10 @@ target_to_texture_binding(GLuint target)
 	return 0;
 }
 
-bool
-piglit_ktx_load_texture(struct piglit_ktx *self,
-			GLuint *tex_name,
-			GLenum *gl_error)
+static bool
+piglit_ktx_load_texture_images(struct piglit_ktx *self,
+			       GLuint *tex_name,
+			       GLenum *gl_error)
 {
 	const struct piglit_ktx_info *info = &self->info;
 
@@ -846,6 +907,47 @@ cleanup:
 	return ok;
 }
 
+bool
+piglit_ktx_load_texture(struct piglit_ktx *self,
+			GLuint *tex_name,
+			GLenum *gl_error)
+{
+	return piglit_ktx_load_texture_images(self, tex_name, gl_error);
+}
+
+bool
+piglit_ktx_load_texture_from_pbo(struct piglit_ktx *self,
+				 GLuint *tex_name,
+				 GLenum *gl_error)
+{
+	GLint old_pbo;
+	GLuint pbo;
+	GLenum my_gl_error;
+	bool ok;
+
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &old_pbo);
+
+	glGenBuffers(1, &pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, self->info.size, self->data,
+		     GL_STATIC_DRAW);
+
+	my_gl_error = glGetError();
+	if (my_gl_error) {
+		if (gl_error != NULL)
+			*gl_error = my_gl_error;
+		ok = false;
+	} else {
+		self->use_pbo = true;
+		ok = piglit_ktx_load_texture_images(self, tex_name, gl_error);
+		self->use_pbo = false;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, old_pbo);
+	glDeleteBuffers(1, &pbo);
+	return ok;
+}
+
 const struct piglit_ktx_info*
 piglit_ktx_get_info(struct piglit_ktx *self)
 {
@@ -191,7 +191,9 @@ piglit_ktx_destroy(struct piglit_ktx *self);
 /**
  * \brief Read KTX data from a file.
  *
- * The file is read until EOF.
+ * The file is read until EOF. Where mmap() is available, the file is
+ * mapped rather than copied to memory, and the texture images are uploaded
+ * straight from the mapping.
  *
  * Return null on error, including I/O error and invalid data.
  */
@@ -265,6 +267,19 @@ piglit_ktx_load_texture(struct piglit_ktx *self,
 			GLuint *tex_name,
 			GLenum *gl_error);
 
+/**
+ * \brief Like piglit_ktx_load_texture(), but upload through a pixel unpack
+ * buffer.
+ *
+ * The KTX data is first copied into a buffer object, from which all texture
+ * images are then loaded. Requires GL 2.1, GL_ARB_pixel_buffer_object or
+ * GLES 3.0.
+ */
+bool
+piglit_ktx_load_texture_from_pbo(struct piglit_ktx *self,
+				 GLuint *tex_name,
+				 GLenum *gl_error);
+
 #ifdef __cplusplus
 }
 #endif
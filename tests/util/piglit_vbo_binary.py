@@ -0,0 +1,145 @@
+#!/usr/bin/env python2
+# coding=utf-8
+#
+# Copyright © 2013 The Piglit project
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# Convert textual vertex data, as found in the [vertex data] section of
+# a shader_runner script, into the binary format loaded by
+# setup_vbo_from_file() (see piglit-vbo.cpp).
+#
+# Usage: piglit_vbo_binary.py <input> <output.vbo>
+#
+# <input> is either a .shader_test file, whose [vertex data] section is
+# converted, or a file containing only vertex data.  The script can
+# then use the binary file with a [vertex data file] section naming
+# <output.vbo>, relative to the script's directory.
+#
+# Test generators can call vertex_data_to_binary() directly.
+
+import re
+import struct
+import sys
+
+MAGIC = 'piglit vbo 1\n'
+
+_FORMATS = {'float': '<f', 'int': '<i', 'uint': '<I'}
+
+
+# An integer as strtol()/strtoul() with base 0, which piglit-vbo.cpp
+# uses, read it: hexadecimal after 0x, octal after a leading 0.
+_RE_INT = re.compile(r'\A[+-]?(0[xX][0-9a-fA-F]+|0[0-7]*|[1-9][0-9]*)\Z')
+
+
+def _parse_int(text, signed):
+    m = _RE_INT.match(text)
+    if m is None:
+        raise ValueError('invalid integer: {0!r}'.format(text))
+    digits = m.group(1)
+    if digits[:2] in ('0x', '0X'):
+        value = int(digits[2:], 16)
+    elif len(digits) > 1:
+        value = int(digits, 8) if digits[0] == '0' else int(digits, 10)
+    else:
+        value = int(digits, 10)
+    if text[0] == '-':
+        value = -value
+
+    # piglit-vbo.cpp casts the value to a GLint or GLuint.
+    value &= 0xffffffff
+    if signed and value >= 0x80000000:
+        value -= 0x100000000
+    return value
+
+
+def vertex_data_to_binary(text):
+    """
+    Convert the text of a [vertex data] section into the contents of
+    a binary vertex data file.
+    """
+    header = None
+    columns = []
+    rows = []
+    for line in text.split('\n'):
+        line = line.split('#', 1)[0].strip()
+        if not line:
+            continue
+
+        if header is None:
+            header = ' '.join(line.split())
+            for column in line.split():
+                name, type_, count = column.split('/')
+                columns.append((_FORMATS[type_], int(count)))
+            continue
+
+        values = line.split()
+        row = []
+        for fmt, count in columns:
+            for _ in xrange(count):
+                value = values.pop(0)
+                if fmt == '<f':
+                    row.append(struct.pack(fmt, float(value)))
+                else:
+                    row.append(struct.pack(fmt,
+                                           _parse_int(value, fmt == '<i')))
+        rows.append(''.join(row))
+
+    if header is None:
+        raise ValueError('vertex data has no column headers')
+
+    return '{0}{1}\n{2}\n{3}'.format(MAGIC, header, len(rows), ''.join(rows))
+
+
+def extract_vertex_data(script):
+    """
+    Return the text of the [vertex data] section of a shader_runner
+    script, or None if it has none.
+    """
+    section = None
+    for line in script.split('\n'):
+        if line.startswith('['):
+            if section is not None:
+                break
+            if line.strip() == '[vertex data]':
+                section = []
+        elif section is not None:
+            section.append(line)
+    return '\n'.join(section) if section is not None else None
+
+
+def main():
+    if len(sys.argv) != 3:
+        print 'Usage: {0} <input> <output.vbo>'.format(sys.argv[0])
+        sys.exit(1)
+
+    with open(sys.argv[1], 'r') as f:
+        text = f.read()
+
+    vertex_data = extract_vertex_data(text)
+    if vertex_data is None:
+        vertex_data = text
+
+    with open(sys.argv[2], 'wb') as f:
+        f.write(vertex_data_to_binary(vertex_data))
+
+
+if __name__ == '__main__':
+    main()